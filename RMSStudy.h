@@ -31,6 +31,7 @@ public :
    Double_t        py;
    Double_t        pz;
    Double_t        ekin;
+   Int_t           plane;
 
    // List of branches
    TBranch        *b_eventID;   //!
@@ -42,6 +43,7 @@ public :
    TBranch        *b_py;   //!
    TBranch        *b_pz;   //!
    TBranch        *b_ekin;   //!
+   TBranch        *b_plane;   //!
 
    RMSStudy(TTree *tree=0);
    virtual ~RMSStudy();
@@ -122,6 +124,7 @@ void RMSStudy::Init(TTree *tree)
    fChain->SetBranchAddress("py", &py, &b_py);
    fChain->SetBranchAddress("pz", &pz, &b_pz);
    fChain->SetBranchAddress("ekin", &ekin, &b_ekin);
+   fChain->SetBranchAddress("plane", &plane, &b_plane);
    Notify();
 }
 
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Benchmark suite: runs each workload macro at 1, 2, 4, ... threads up to
+# the number of cores and collects one JSON record per run in
+# benchmark.jsonl (a previous file is kept as benchmark.jsonl.old).
+#
+# Usage, from the build directory:
+#   make benchmark
+#   sh benchmark.sh [workload.mac ...]
+#
+# The records have the label of the workload, the threads, events/s,
+# photons/s, steps per photon, the peak RSS and the startup time, so runs
+# on different machines or commits can be compared with jq or pandas.
+# The log of each run goes to bench_<workload>_t<threads>.log.
+
+WORKLOADS=${*:-"benchProton.mac benchYield.mac benchMirrorGun.mac benchSTL.mac"}
+CORES=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+
+[ -f benchmark.jsonl ] && mv benchmark.jsonl benchmark.jsonl.old
+
+for mac in $WORKLOADS; do
+  threads=1
+  while [ "$threads" -le "$CORES" ]; do
+    echo "$mac, $threads thread(s)"
+    THREADS=$threads ./waterRadiator "$mac" > "bench_${mac%.mac}_t$threads.log" 2>&1 ||
+      echo "  failed, see bench_${mac%.mac}_t$threads.log"
+    threads=$((threads * 2))
+  done
+done
+
+cat benchmark.jsonl
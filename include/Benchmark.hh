@@ -0,0 +1,74 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file Benchmark.hh
+/// \brief Definition of the B1::Benchmark class
+
+#ifndef B1Benchmark_h
+#define B1Benchmark_h 1
+
+#include "globals.hh"
+
+class G4GenericMessenger;
+
+namespace B1
+{
+
+class StepProfiler;
+
+/// Writes the performance of each run as one line of JSON, for the
+/// benchmark workloads and for sizing production jobs.
+///
+/// The master appends a record to the file set with
+/// /waterRadiator/benchmark/json at the end of every run: events/s,
+/// optical photons tracked/s, steps per photon, the peak resident memory
+/// of the process and the startup time, from program start to the start
+/// of the first run (geometry, including any mesh import, and physics
+/// tables). With /waterRadiator/profile/processes the record also has
+/// the process profile. Nothing is written while no file is set.
+
+class Benchmark
+{
+  public:
+    Benchmark();
+    ~Benchmark();
+
+    void BeginOfRun();
+    void EndOfRun(G4int nEvents, G4long nPhotons, G4long nPhotonSteps, G4double realTime,
+                  const StepProfiler& profiler);
+
+  private:
+    void DefineCommands();
+
+    G4GenericMessenger* fMessenger = nullptr;
+    G4String fFileName;
+    G4String fLabel = "run";
+
+    G4double fStartup = -1.;  // seconds, set at the first run
+};
+
+}  // namespace B1
+
+#endif
@@ -93,7 +93,18 @@ Type TypeFromName(G4String name);
 #include "G4ThreeVector.hh"
 #include "G4TriangularFacet.hh"
 
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <memory>
+#include <numeric>
+#include <ostream>
+#include <queue>
+#include <set>
+#include <thread>
 #include <vector>
 
 namespace CADMesh {
@@ -101,6 +112,130 @@ namespace CADMesh {
 typedef std::vector<G4ThreeVector> Points;
 typedef std::vector<G4TriangularFacet *> Triangles;
 
+typedef std::array<size_t, 3> IndexedTriangle;
+typedef std::vector<IndexedTriangle> IndexedTriangles;
+
+// A mesh after vertex welding: each triangle refers to a table of unique
+// vertices instead of holding its own copies.
+struct WeldedMesh {
+  Points vertices;
+  IndexedTriangles triangles;
+};
+
+// Merges points that are closer than the tolerance, using a spatial hash
+// with one cell per tolerance step. A tolerance of zero merges only points
+// with identical coordinates.
+class VertexWelder {
+public:
+  VertexWelder(size_t expected_points, G4double tolerance = 0.);
+
+  size_t Add(const G4ThreeVector &point);
+
+  // The index of a point within the tolerance, or SIZE_MAX if there is none.
+  size_t Find(const G4ThreeVector &point);
+
+  Points &GetVertices() { return vertices_; };
+
+private:
+  struct Cell {
+    int64_t x, y, z;
+    size_t head;
+  };
+
+  void CellOf(const G4ThreeVector &point, int64_t &x, int64_t &y, int64_t &z);
+  size_t Slot(int64_t x, int64_t y, int64_t z);
+  void Grow();
+
+  G4double tolerance_;
+
+  Points vertices_;
+  std::vector<size_t> next_;
+
+  std::vector<Cell> cells_;
+  size_t used_cells_ = 0;
+};
+
+// The result of validating a mesh for navigation. Every edge of a closed,
+// manifold mesh is used by exactly two facets, once in each direction.
+struct Validation {
+  size_t facets = 0;
+  size_t vertices = 0;
+  size_t edges = 0;
+
+  size_t boundary_edges = 0;  // used by one facet
+  // Connected groups of open edges. Each hole is one group, but holes that
+  // touch at a vertex are counted together.
+  size_t boundary_components = 0;
+  size_t non_manifold_edges = 0;  // used by more than two facets
+  size_t flipped_edges = 0;  // used twice in the same direction
+  size_t degenerate_facets = 0;  // facets with welded vertices
+
+  G4bool IsValidForNavigation() const {
+    return boundary_edges == 0 && non_manifold_edges == 0;
+  };
+};
+
+std::ostream &operator<<(std::ostream &stream, const Validation &validation);
+
+Validation Validate(const WeldedMesh &mesh);
+
+// The quadric error of Garland and Heckbert: the sum of squared distances
+// from a point to a set of planes, kept as the upper triangle of a
+// symmetric 4x4 matrix.
+struct Quadric {
+  G4double q[10] = {0., 0., 0., 0., 0., 0., 0., 0., 0., 0.};
+
+  void AddPlane(const G4ThreeVector &normal, G4double d);
+
+  Quadric &operator+=(const Quadric &other);
+
+  G4double Error(const G4ThreeVector &point) const;
+
+  // The point of least error, if the planes pin one down.
+  G4bool Minimum(G4ThreeVector &point) const;
+};
+
+// A region of a mesh that follows an analytic surface to within a tolerance.
+struct Patch {
+  enum Kind { Plane, Sphere, Torus };
+
+  Kind kind = Plane;
+
+  G4ThreeVector origin;  // a point on the plane, or the centre
+  G4ThreeVector axis;  // the plane normal, or the torus axis
+  G4double radius = 0.;  // sphere radius, or torus major radius
+  G4double minor_radius = 0.;  // torus tube radius
+
+  G4double max_residual = 0.;
+  G4double area = 0.;
+
+  std::vector<size_t> facets;  // indices into the mesh triangles
+};
+
+typedef std::vector<Patch> Patches;
+
+std::ostream &operator<<(std::ostream &stream, const Patch &patch);
+
+// Splits the mesh into planar, spherical and toroidal patches by region
+// growing: each unassigned facet seeds a region of each kind, which grows
+// across shared edges while every vertex stays within the tolerance of the
+// fitted surface, and the largest region wins. Tori are fitted about an
+// axis through the origin of the mesh.
+Patches FindPatches(const WeldedMesh &mesh, G4double tolerance,
+                    G4ThreeVector torus_axis = G4ThreeVector(0, 0, 1));
+
+namespace Fit {
+
+// Least squares fits of a patch surface to points. Each returns false when
+// the points do not pin the surface down.
+G4bool Plane(const Points &points, Patch &patch);
+G4bool Sphere(const Points &points, Patch &patch);
+G4bool Torus(const Points &points, Patch &patch);
+
+// Distance from the point to the surface of the patch.
+G4double Residual(const Patch &patch, const G4ThreeVector &point);
+}
+
 class Mesh {
 public:
   Mesh(Points points, Triangles triangles, G4String name = "");
@@ -120,11 +255,29 @@ public:
 
   G4bool IsValidForNavigation();
 
+  WeldedMesh Weld(G4double tolerance = 0.);
+  Validation Validate(G4double tolerance = 0.);
+
+  // Lets a reader that already knows the exact-weld validation (e.g. from a
+  // cache) skip recomputing it.
+  void SetValidation(Validation validation);
+
+  // A copy with fewer facets, made by quadric error edge collapse. No
+  // collapse moves the surface further than max_deviation from any of the
+  // original facet planes it replaces. Open and non-manifold edges are kept.
+  std::shared_ptr<Mesh> Decimate(G4double max_deviation);
+
+  Patches FindPatches(G4double tolerance,
+                      G4ThreeVector torus_axis = G4ThreeVector(0, 0, 1));
+
 private:
   G4String name_ = "";
 
   Points points_;
   Triangles triangles_;
+
+  G4bool validated_ = false;
+  Validation validation_;
 };
 
 typedef std::vector<std::shared_ptr<Mesh>> Meshes;
@@ -134,6 +287,86 @@ namespace CADMesh {
 
 namespace File {
 
+// Receives facets from a reader as the file is parsed, without a Mesh being
+// built first. BeginMesh and EndMesh bracket each mesh in the file; the size
+// is the number of facets expected, or zero if the format does not say.
+// Returning false from AddFacet stops the parse.
+class FacetSink {
+public:
+  virtual ~FacetSink() {}
+
+  virtual void BeginMesh(G4String /*name*/, size_t /*size*/) {}
+  virtual G4bool AddFacet(const G4ThreeVector &a, const G4ThreeVector &b,
+                          const G4ThreeVector &c) = 0;
+  virtual void EndMesh() {}
+};
+
+typedef std::function<G4bool(const G4ThreeVector &, const G4ThreeVector &,
+                             const G4ThreeVector &)>
+    FacetCallback;
+
+// Builds the meshes that Reader::Read returns.
+class MeshSink : public FacetSink {
+public:
+  void BeginMesh(G4String name, size_t size);
+  G4bool AddFacet(const G4ThreeVector &a, const G4ThreeVector &b,
+                  const G4ThreeVector &c);
+  void EndMesh();
+
+  Meshes GetMeshes() { return meshes_; };
+
+  // Deletes the facets of a parse that failed part way through.
+  void Discard();
+
+private:
+  Meshes meshes_;
+
+  G4String name_;
+  Triangles triangles_;
+};
+
+// Passes on the facets whose bounding box overlaps the box.
+class BoxFilter : public FacetSink {
+public:
+  BoxFilter(G4ThreeVector min, G4ThreeVector max, FacetSink &sink);
+
+  void BeginMesh(G4String name, size_t size);
+  G4bool AddFacet(const G4ThreeVector &a, const G4ThreeVector &b,
+                  const G4ThreeVector &c);
+  void EndMesh();
+
+private:
+  G4ThreeVector min_;
+  G4ThreeVector max_;
+
+  FacetSink &sink_;
+};
+
+// Welds the facets as they arrive, so only the unique vertices and three
+// indices per facet are kept. The result can be validated or searched for
+// patches without a Mesh of G4TriangularFacets ever existing.
+class WeldingSink : public FacetSink {
+public:
+  WeldingSink(G4double tolerance = 0.);
+
+  void BeginMesh(G4String name, size_t size);
+  G4bool AddFacet(const G4ThreeVector &a, const G4ThreeVector &b,
+                  const G4ThreeVector &c);
+  void EndMesh();
+
+  std::vector<WeldedMesh> &GetMeshes() { return meshes_; };
+  std::vector<G4String> &GetNames() { return names_; };
+
+private:
+  G4double tolerance_;
+
+  std::unique_ptr<VertexWelder> welder_;
+  IndexedTriangles triangles_;
+
+  std::vector<WeldedMesh> meshes_;
+  std::vector<G4String> names_;
+};
+
 class Reader {
 public:
   Reader(G4String reader_name);
@@ -142,6 +375,12 @@ public:
   virtual G4bool Read(G4String filepath) = 0;
   virtual G4bool CanRead(Type file_type) = 0;
 
+  // Sends the facets of the file to the sink. Readers that can parse
+  // straight into a sink override this; the default reads the whole file
+  // and then replays its meshes.
+  virtual G4bool Stream(G4String filepath, FacetSink &sink);
+  G4bool Stream(G4String filepath, FacetCallback callback);
+
 public:
   G4String GetName();
 
@@ -175,8 +414,8 @@ namespace File {
 struct Token {
   std::string name;
 
-  bool operator==(Token other) { return name == other.name; };
-  bool operator!=(Token other) { return name != other.name; };
+  bool operator==(const Token &other) const { return name == other.name; };
+  bool operator!=(const Token &other) const { return name != other.name; };
 };
 
 static Token ErrorToken{"ErrorToken"};
@@ -304,6 +543,66 @@ private:
 }
 }
 
+#if defined(__unix__) || defined(__APPLE__)
+#define CADMESH_USE_MMAP
+#endif
+
+namespace CADMesh {
+
+namespace File {
+
+// A read-only view of a whole file. It is memory mapped where possible so
+// that large meshes are parsed in place without being copied into a string.
+class MappedFile {
+public:
+  MappedFile(std::string filepath);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+public:
+  G4bool IsOpen();
+
+  const char *Data();
+  size_t Size();
+
+private:
+  G4bool open_ = false;
+
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+
+#ifdef CADMESH_USE_MMAP
+  void *mapping_ = nullptr;
+#else
+  std::vector<char> buffer_;
+#endif
+};
+
+// A minimal cursor over a text buffer used by the fast ASCII parsers. It
+// never allocates except for names, and numbers are converted in place.
+struct Scanner {
+  const char *position;
+  const char *end;
+
+  bool AtEnd();
+  bool AtLineEnd();
+
+  void SkipBlanks();
+  void SkipSpace();
+  void NextLine();
+
+  bool Keyword(const char *word);
+
+  bool ReadDouble(double &value);
+  bool ReadInteger(long &value);
+
+  std::string ReadRestOfLine();
+};
+}
+}
+
 #ifdef USE_CADMESH_ASSIMP_READER
 
 #include "assimp/Importer.hpp"
@@ -343,9 +642,43 @@ public:
 public:
   G4bool Read(G4String filepath);
   G4bool CanRead(File::Type file_type);
+
+  using Reader::Stream;
+  G4bool Stream(G4String filepath, FacetSink &sink);
 };
 
 std::shared_ptr<BuiltInReader> BuiltIn();
+
+// Wraps another reader with an on-disk cache. The first read of a file
+// stores its welded, validated meshes in a compact binary file named after
+// a hash of the source contents; later reads map that file instead of
+// parsing the source again.
+class CachedReader : public Reader {
+public:
+  CachedReader(std::shared_ptr<Reader> reader, G4String directory);
+
+public:
+  G4bool Read(G4String filepath);
+  G4bool CanRead(File::Type file_type);
+
+private:
+  G4String CachePath(G4String filepath, uint64_t hash);
+
+  G4bool ReadCache(G4String cache_path, uint64_t hash, uint64_t size);
+  G4bool WriteCache(G4String cache_path, uint64_t hash, uint64_t size);
+
+  std::shared_ptr<Reader> reader_;
+  G4String directory_;
+};
+
+std::shared_ptr<CachedReader> Cached(std::shared_ptr<Reader> reader,
+                                     G4String directory = ".cadmesh");
+
+// Streams the facets of a file with the built in readers.
+G4bool Stream(G4String filepath, FacetSink &sink);
+G4bool Stream(G4String filepath, FacetCallback callback);
+
+uint64_t HashContents(const char *data, size_t size);
 }
 }
 #ifndef CADMESH_DEFAULT_READER
@@ -353,10 +686,18 @@ std::shared_ptr<BuiltInReader> BuiltIn();
 #endif
 
 #include "G4AssemblyVolume.hh"
+#include "G4DisplacedSolid.hh"
+#include "G4ExtrudedSolid.hh"
+#include "G4GenericTrap.hh"
 #include "G4LogicalVolume.hh"
 #include "G4Material.hh"
+#include "G4MultiUnion.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4Sphere.hh"
 #include "G4TessellatedSolid.hh"
 #include "G4Tet.hh"
+#include "G4Torus.hh"
+#include "G4TwoVector.hh"
 #include "G4UIcommand.hh"
 
 namespace CADMesh {
@@ -407,7 +748,16 @@ public:
 
   virtual G4AssemblyVolume *GetAssembly() = 0;
 
+  // The meshes as read from the file, e.g. to decimate and check one before
+  // building its solid.
+  std::shared_ptr<Mesh> GetMesh();
+  std::shared_ptr<Mesh> GetMesh(G4int index);
+
   bool IsValidForNavigation();
+  Validation Validate(G4double tolerance = 0.);
+
+  Patches FindPatches(G4double tolerance,
+                      G4ThreeVector torus_axis = G4ThreeVector(0, 0, 1));
 
 public:
   G4String GetFileName();
@@ -454,6 +804,8 @@ void ReaderCantReadError(G4String origin, File::Type file_type,
 
 void MeshNotFound(G4String origin, size_t index);
 void MeshNotFound(G4String origin, G4String name);
+
+void InvalidMesh(G4String origin, G4String message);
 }
 }
 
@@ -474,6 +826,18 @@ public:
   G4TessellatedSolid *GetTessellatedSolid(G4String name, G4bool exact = true);
   G4TessellatedSolid *GetTessellatedSolid(std::shared_ptr<Mesh> mesh);
 
+  // Replaces the pieces of the mesh that FindPatches recognises as slabs,
+  // spherical shells or toroidal shells with the equivalent CSG solid, and
+  // pieces that are a strip of facets swept along a fixed vector (such as a
+  // mirror of flat or slightly twisted segments) with one G4GenericTrap per
+  // segment. Other pieces stay tessellated, decimated if a maximum deviation
+  // is set, and the result is a G4MultiUnion if there is more than one
+  // piece. The patches found are copied to found if it is given, so callers
+  // don't have to fit the mesh a second time.
+  G4VSolid *GetAnalyticSolid(G4double tolerance, Patches *found = nullptr);
+  G4VSolid *GetAnalyticSolid(std::shared_ptr<Mesh> mesh, G4double tolerance,
+                             Patches *found = nullptr);
+
   G4AssemblyVolume *GetAssembly();
 
 public:
@@ -481,8 +845,33 @@ public:
 
   G4bool GetReverse() { return this->reverse_; };
 
+  void SetMaxVoxels(G4int max_voxels) { this->max_voxels_ = max_voxels; };
+
+  G4int GetMaxVoxels() { return this->max_voxels_; };
+
+  void SetVoxelReductionRatio(G4ThreeVector ratio) {
+    this->voxel_reduction_ratio_ = ratio;
+  };
+
+  G4ThreeVector GetVoxelReductionRatio() {
+    return this->voxel_reduction_ratio_;
+  };
+
+  // Decimate meshes before building solids. The deviation is in the units
+  // of the solid, i.e. after scaling; zero keeps every facet.
+  void SetMaxDeviation(G4double max_deviation) {
+    this->max_deviation_ = max_deviation;
+  };
+
+  G4double GetMaxDeviation() { return this->max_deviation_; };
+
 private:
-  G4bool reverse_;
+  G4bool reverse_ = false;
+
+  G4int max_voxels_ = -1;
+  G4ThreeVector voxel_reduction_ratio_ = G4ThreeVector();
+
+  G4double max_deviation_ = 0.;
 };
 }
 
@@ -563,17 +952,16 @@ inline Type TypeFromName(G4String name) {
 namespace CADMesh {
 
 inline Mesh::Mesh(Points points, Triangles triangles, G4String name)
-    : name_(name), points_(points), triangles_(triangles) {}
+    : name_(name), points_(std::move(points)),
+      triangles_(std::move(triangles)) {}
 
 inline std::shared_ptr<Mesh> Mesh::New(Points points, Triangles triangles,
                                        G4String name) {
-  return std::make_shared<Mesh>(points, triangles, name);
+  return std::make_shared<Mesh>(std::move(points), std::move(triangles), name);
 }
 
 inline std::shared_ptr<Mesh> Mesh::New(Triangles triangles, G4String name) {
-  Points points;
-
-  return New(points, triangles, name);
+  return New(Points(), std::move(triangles), name);
 }
 
 inline std::shared_ptr<Mesh> Mesh::New(std::shared_ptr<Mesh> mesh,
@@ -588,175 +976,1557 @@ inline Points Mesh::GetPoints() { return points_; }
 inline Triangles Mesh::GetTriangles() { return triangles_; }
 
 inline G4bool Mesh::IsValidForNavigation() {
-  std::map<G4ThreeVector, size_t> point_index;
+  return Validate().IsValidForNavigation();
+}
 
-  size_t index = 0;
-  for (auto point : points_) {
-    point_index[point] = index;
-    index++;
+inline WeldedMesh Mesh::Weld(G4double tolerance) {
+  VertexWelder welder(3 * triangles_.size(), tolerance);
+
+  WeldedMesh mesh;
+  mesh.triangles.reserve(triangles_.size());
+
+  for (auto triangle : triangles_) {
+    mesh.triangles.push_back(IndexedTriangle{welder.Add(triangle->GetVertex(0)),
+                                             welder.Add(triangle->GetVertex(1)),
+                                             welder.Add(triangle->GetVertex(2))});
   }
 
-  typedef std::pair<size_t, size_t> Edge;
-  std::map<Edge, G4int> edge_use_count;
+  mesh.vertices = std::move(welder.GetVertices());
 
-  for (size_t i = 0; i < triangles_.size(); i++) {
-    auto triangle = triangles_[i];
+  return mesh;
+}
 
-    size_t a = point_index[triangle->GetVertex(0)];
-    size_t b = point_index[triangle->GetVertex(1)];
-    size_t c = point_index[triangle->GetVertex(2)];
+inline Validation Mesh::Validate(G4double tolerance) {
+  if (tolerance > 0.) {
+    return CADMesh::Validate(Weld(tolerance));
+  }
 
-    if (a < b) {
-      edge_use_count[Edge(a, b)] += 1;
-    }
+  if (!validated_) {
+    SetValidation(CADMesh::Validate(Weld()));
+  }
 
-    else if (a > b) {
-      edge_use_count[Edge(b, a)] += 1;
-    }
+  return validation_;
+}
 
-    if (b < c) {
-      edge_use_count[Edge(b, c)] += 1;
-    }
+inline void Mesh::SetValidation(Validation validation) {
+  validation_ = validation;
+  validated_ = true;
+}
 
-    else if (b > c) {
-      edge_use_count[Edge(c, b)] += 1;
-    }
+inline std::shared_ptr<Mesh> Mesh::Decimate(G4double max_deviation) {
+  auto welded = Weld();
 
-    if (c < a) {
-      edge_use_count[Edge(c, a)] += 1;
-    }
+  auto &vertices = welded.vertices;
+  auto &faces = welded.triangles;
 
-    else if (c > a) {
-      edge_use_count[Edge(a, c)] += 1;
-    }
-  }
+  size_t vertex_count = vertices.size();
+  size_t face_count = faces.size();
 
-  for (auto count : edge_use_count) {
-    if (count.second != 2) {
-      return false;
-    }
-  }
+  std::vector<Quadric> quadrics(vertex_count);
+  std::vector<std::vector<size_t>> vertex_faces(vertex_count);
+  std::vector<G4bool> face_alive(face_count, false);
 
-  return true;
-}
-}
+  for (size_t f = 0; f < face_count; f++) {
+    auto &face = faces[f];
 
-namespace CADMesh {
+    auto normal = (vertices[face[1]] - vertices[face[0]])
+                      .cross(vertices[face[2]] - vertices[face[0]]);
 
-namespace File {
+    if (normal.mag2() == 0.) {
+      continue;
+    }
 
-inline Reader::Reader(G4String reader_name) : name_(reader_name) {}
+    normal = normal.unit();
 
-inline Reader::~Reader() {}
+    Quadric plane;
+    plane.AddPlane(normal, -normal.dot(vertices[face[0]]));
 
-inline G4String Reader::GetName() { return name_; }
+    for (auto v : face) {
+      quadrics[v] += plane;
+      vertex_faces[v].push_back(f);
+    }
 
-inline std::shared_ptr<Mesh> Reader::GetMesh() {
-  if (meshes_.size() > 0) {
-    return meshes_[0];
+    face_alive[f] = true;
   }
 
-  return nullptr;
-}
+  // Vertices on open or non-manifold edges are locked in place.
+  std::vector<std::pair<size_t, size_t>> edges;
+  edges.reserve(3 * face_count);
 
-inline std::shared_ptr<Mesh> Reader::GetMesh(size_t index) {
-  if (index < meshes_.size()) {
-    return meshes_[index];
+  for (size_t f = 0; f < face_count; f++) {
+    if (!face_alive[f]) {
+      continue;
+    }
+
+    for (size_t j = 0; j < 3; j++) {
+      size_t a = faces[f][j];
+      size_t b = faces[f][(j + 1) % 3];
+
+      edges.emplace_back(std::min(a, b), std::max(a, b));
+    }
   }
 
-  Exceptions::MeshNotFound("Reader::GetMesh", index);
+  std::sort(edges.begin(), edges.end());
 
-  return nullptr;
-}
+  std::vector<G4bool> locked(vertex_count, false);
 
-inline std::shared_ptr<Mesh> Reader::GetMesh(G4String name, G4bool exact) {
-  for (auto mesh : meshes_) {
-    if (exact) {
-      if (mesh->GetName() == name)
-        return mesh;
+  for (size_t i = 0; i < edges.size();) {
+    size_t j = i;
+
+    while (j < edges.size() && edges[j] == edges[i]) {
+      j++;
     }
 
-    else {
-      if (mesh->GetName().find(name) != std::string::npos)
-        return mesh;
+    if (j - i != 2) {
+      locked[edges[i].first] = true;
+      locked[edges[i].second] = true;
     }
+
+    i = j;
   }
 
-  Exceptions::MeshNotFound("Reader::GetMesh", name);
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
 
-  return nullptr;
-}
+  struct Collapse {
+    G4double cost;
+    size_t a, b;
+    size_t stamp_a, stamp_b;
+    G4ThreeVector position;
 
-inline Meshes Reader::GetMeshes() { return meshes_; }
+    bool operator>(const Collapse &other) const { return cost > other.cost; }
+  };
 
-inline size_t Reader::GetNumberOfMeshes() { return meshes_.size(); }
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>>
+      queue;
 
-inline size_t Reader::AddMesh(std::shared_ptr<Mesh> mesh) {
-  meshes_.push_back(mesh);
+  std::vector<size_t> stamps(vertex_count, 0);
+  std::vector<G4bool> removed(vertex_count, false);
 
-  return meshes_.size();
-}
+  G4double max_error = max_deviation * max_deviation;
 
-inline void Reader::SetMeshes(Meshes meshes) { meshes_ = meshes; }
-}
-}
+  auto consider = [&](size_t a, size_t b) {
+    if (locked[a] || locked[b]) {
+      return;
+    }
 
-#include <fstream>
-#include <sstream>
-#include <streambuf>
+    Quadric quadric = quadrics[a];
+    quadric += quadrics[b];
 
-namespace CADMesh {
+    // Fall back to the ends and the midpoint where the planes are flat or
+    // parallel and do not fix a single point.
+    G4ThreeVector candidates[4] = {vertices[a], vertices[b],
+                                   (vertices[a] + vertices[b]) / 2.,
+                                   G4ThreeVector()};
+    size_t candidate_count = quadric.Minimum(candidates[3]) ? 4 : 3;
 
-namespace File {
+    Collapse collapse{DBL_MAX, a, b, stamps[a], stamps[b], G4ThreeVector()};
 
-inline Lexer::Lexer(std::string filepath, State *initial_state) {
-  std::ifstream file(filepath);
-  input_ = std::string((std::istreambuf_iterator<char>(file)),
-                       std::istreambuf_iterator<char>());
+    for (size_t i = 0; i < candidate_count; i++) {
+      G4double error = std::max(0., quadric.Error(candidates[i]));
 
-  if (initial_state) {
-    Run(initial_state);
+      if (error < collapse.cost) {
+        collapse.cost = error;
+        collapse.position = candidates[i];
+      }
+    }
+
+    if (collapse.cost <= max_error) {
+      queue.push(collapse);
+    }
+  };
+
+  for (const auto &edge : edges) {
+    consider(edge.first, edge.second);
   }
-}
 
-inline std::string Lexer::String() {
-  return input_.substr(start_, position_ - start_);
-}
+  auto contains = [&](size_t f, size_t v) {
+    return faces[f][0] == v || faces[f][1] == v || faces[f][2] == v;
+  };
 
-inline void Lexer::Run(State *initial_state, size_t lines) {
-  parent_item_ = new Item{ParentToken, position_,          line_, "", "",
-                          nullptr,     std::vector<Item>()};
+  // Would moving v to position flip or flatten any face of v that does not
+  // also hold other?
+  auto folds = [&](size_t v, size_t other, const G4ThreeVector &position) {
+    for (auto f : vertex_faces[v]) {
+      if (!face_alive[f] || contains(f, other)) {
+        continue;
+      }
 
-  state_ = initial_state;
+      G4ThreeVector corners[3];
+      for (size_t j = 0; j < 3; j++) {
+        corners[j] = faces[f][j] == v ? position : vertices[faces[f][j]];
+      }
 
-  end_line_ = 0;
+      auto before = (vertices[faces[f][1]] - vertices[faces[f][0]])
+                        .cross(vertices[faces[f][2]] - vertices[faces[f][0]]);
+      auto after = (corners[1] - corners[0]).cross(corners[2] - corners[0]);
 
-  if (lines > 0)
-    end_line_ = line_ + lines;
+      if (after.mag2() <= 1e-12 * before.mag2() || before.dot(after) <= 0.) {
+        return true;
+      }
+    }
 
-  while (state_) {
-    state_ = (*state_)(this);
-  }
-}
+    return false;
+  };
 
-inline Items Lexer::GetItems() { return parent_item_->children; }
+  std::vector<size_t> neighbours_a, neighbours_b;
 
-inline void Lexer::Backup() {
-  position_ -= width_;
+  auto neighbours = [&](size_t v, std::vector<size_t> &result) {
+    result.clear();
 
-  auto next = input_.substr(position_, 1);
+    for (auto f : vertex_faces[v]) {
+      if (face_alive[f]) {
+        for (auto u : faces[f]) {
+          if (u != v) {
+            result.push_back(u);
+          }
+        }
+      }
+    }
 
-  if (next == "\n") {
-    line_--;
-  }
-}
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+  };
 
-inline void Lexer::BackupTo(int position) {
-  auto s = input_.substr(position, position_ - position);
-  line_ -= std::count(s.begin(), s.end(), '\n');
+  while (!queue.empty()) {
+    auto collapse = queue.top();
+    queue.pop();
 
-  position_ = position;
-}
+    size_t a = collapse.a;
+    size_t b = collapse.b;
+
+    if (removed[a] || removed[b] || stamps[a] != collapse.stamp_a ||
+        stamps[b] != collapse.stamp_b) {
+      continue;
+    }
+
+    // The link condition: an interior edge may only collapse if its ends
+    // share exactly the two neighbours on either side of it. Otherwise the
+    // result is not manifold.
+    neighbours(a, neighbours_a);
+    neighbours(b, neighbours_b);
+
+    size_t shared = 0;
+    for (auto v : neighbours_a) {
+      shared += std::binary_search(neighbours_b.begin(), neighbours_b.end(), v);
+    }
+
+    if (shared != 2) {
+      continue;
+    }
+
+    if (folds(a, b, collapse.position) || folds(b, a, collapse.position)) {
+      continue;
+    }
+
+    vertices[a] = collapse.position;
+    quadrics[a] += quadrics[b];
+
+    for (auto f : vertex_faces[b]) {
+      if (!face_alive[f]) {
+        continue;
+      }
+
+      if (contains(f, a)) {
+        face_alive[f] = false;
+        continue;
+      }
+
+      for (auto &v : faces[f]) {
+        if (v == b) {
+          v = a;
+        }
+      }
+
+      vertex_faces[a].push_back(f);
+    }
+
+    vertex_faces[a].erase(std::remove_if(vertex_faces[a].begin(),
+                                         vertex_faces[a].end(),
+                                         [&](size_t f) {
+                                           return !face_alive[f];
+                                         }),
+                          vertex_faces[a].end());
+
+    removed[b] = true;
+    std::vector<size_t>().swap(vertex_faces[b]);
+
+    stamps[a]++;
+    stamps[b]++;
+
+    neighbours(a, neighbours_a);
+
+    for (auto v : neighbours_a) {
+      consider(a, v);
+    }
+  }
+
+  // Renumber the surviving vertices in their original order.
+  std::vector<size_t> index(vertex_count, SIZE_MAX);
+  Points points;
+  Triangles triangles;
+
+  for (size_t f = 0; f < face_count; f++) {
+    if (!face_alive[f]) {
+      continue;
+    }
+
+    G4ThreeVector corners[3];
+
+    for (size_t j = 0; j < 3; j++) {
+      size_t v = faces[f][j];
+
+      if (index[v] == SIZE_MAX) {
+        index[v] = points.size();
+        points.push_back(vertices[v]);
+      }
+
+      corners[j] = vertices[v];
+    }
+
+    triangles.push_back(
+        new G4TriangularFacet(corners[0], corners[1], corners[2], ABSOLUTE));
+  }
+
+  return New(std::move(points), std::move(triangles), name_);
+}
+
+inline void Quadric::AddPlane(const G4ThreeVector &n, G4double d) {
+  q[0] += n.x() * n.x();
+  q[1] += n.x() * n.y();
+  q[2] += n.x() * n.z();
+  q[3] += n.x() * d;
+  q[4] += n.y() * n.y();
+  q[5] += n.y() * n.z();
+  q[6] += n.y() * d;
+  q[7] += n.z() * n.z();
+  q[8] += n.z() * d;
+  q[9] += d * d;
+}
+
+inline Quadric &Quadric::operator+=(const Quadric &other) {
+  for (size_t i = 0; i < 10; i++) {
+    q[i] += other.q[i];
+  }
+
+  return *this;
+}
+
+inline G4double Quadric::Error(const G4ThreeVector &p) const {
+  G4double x = p.x(), y = p.y(), z = p.z();
+
+  return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x +
+         q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y + q[7] * z * z +
+         2 * q[8] * z + q[9];
+}
+
+inline G4bool Quadric::Minimum(G4ThreeVector &point) const {
+  // Solve A p = -b by Cramer's rule, where A is the upper left 3x3 block.
+  G4double a00 = q[0], a01 = q[1], a02 = q[2];
+  G4double a11 = q[4], a12 = q[5], a22 = q[7];
+  G4double b0 = -q[3], b1 = -q[6], b2 = -q[8];
+
+  G4double c00 = a11 * a22 - a12 * a12;
+  G4double c01 = a02 * a12 - a01 * a22;
+  G4double c02 = a01 * a12 - a02 * a11;
+
+  G4double determinant = a00 * c00 + a01 * c01 + a02 * c02;
+
+  // The trace sets the scale: a nearly flat set of planes has a tiny
+  // determinant relative to it and the solution is ill-conditioned.
+  G4double trace = a00 + a11 + a22;
+
+  if (std::abs(determinant) <= 1e-6 * trace * trace * trace) {
+    return false;
+  }
+
+  G4double c11 = a00 * a22 - a02 * a02;
+  G4double c12 = a01 * a02 - a00 * a12;
+  G4double c22 = a00 * a11 - a01 * a01;
+
+  point.set((c00 * b0 + c01 * b1 + c02 * b2) / determinant,
+            (c01 * b0 + c11 * b1 + c12 * b2) / determinant,
+            (c02 * b0 + c12 * b1 + c22 * b2) / determinant);
+
+  return true;
+}
+
+namespace Fit {
+
+// Gaussian elimination with partial pivoting on an n x (n + 1) augmented
+// matrix. The pivot threshold is relative to the largest diagonal entry.
+template <size_t N> G4bool Solve(G4double (&a)[N][N + 1], G4double (&x)[N]) {
+  G4double scale = 0.;
+  for (size_t i = 0; i < N; i++) {
+    scale = std::max(scale, std::abs(a[i][i]));
+  }
+
+  for (size_t i = 0; i < N; i++) {
+    size_t pivot = i;
+    for (size_t j = i + 1; j < N; j++) {
+      if (std::abs(a[j][i]) > std::abs(a[pivot][i])) {
+        pivot = j;
+      }
+    }
+
+    if (std::abs(a[pivot][i]) <= 1e-12 * scale) {
+      return false;
+    }
+
+    std::swap(a[i], a[pivot]);
+
+    for (size_t j = i + 1; j < N; j++) {
+      G4double factor = a[j][i] / a[i][i];
+      for (size_t k = i; k <= N; k++) {
+        a[j][k] -= factor * a[i][k];
+      }
+    }
+  }
+
+  for (size_t i = N; i-- > 0;) {
+    x[i] = a[i][N];
+    for (size_t j = i + 1; j < N; j++) {
+      x[i] -= a[i][j] * x[j];
+    }
+    x[i] /= a[i][i];
+  }
+
+  return true;
+}
+
+inline G4ThreeVector Centroid(const Points &points) {
+  G4ThreeVector centroid;
+  for (const auto &point : points) {
+    centroid += point;
+  }
+
+  return centroid / G4double(points.size());
+}
+
+inline G4bool Plane(const Points &points, Patch &patch) {
+  if (points.size() < 3) {
+    return false;
+  }
+
+  auto centroid = Centroid(points);
+
+  G4double m[3][3] = {{0., 0., 0.}, {0., 0., 0.}, {0., 0., 0.}};
+  for (const auto &point : points) {
+    auto d = point - centroid;
+    G4double v[3] = {d.x(), d.y(), d.z()};
+
+    for (size_t i = 0; i < 3; i++) {
+      for (size_t j = 0; j < 3; j++) {
+        m[i][j] += v[i] * v[j];
+      }
+    }
+  }
+
+  // Jacobi rotations; the normal is the eigenvector of the smallest
+  // eigenvalue of the scatter matrix.
+  G4double e[3][3] = {{1., 0., 0.}, {0., 1., 0.}, {0., 0., 1.}};
+
+  for (size_t sweep = 0; sweep < 50; sweep++) {
+    G4double off = m[0][1] * m[0][1] + m[0][2] * m[0][2] + m[1][2] * m[1][2];
+    G4double on = m[0][0] * m[0][0] + m[1][1] * m[1][1] + m[2][2] * m[2][2];
+
+    if (off <= 1e-30 * on) {
+      break;
+    }
+
+    for (size_t p = 0; p < 2; p++) {
+      for (size_t q = p + 1; q < 3; q++) {
+        if (m[p][q] == 0.) {
+          continue;
+        }
+
+        G4double theta = (m[q][q] - m[p][p]) / (2. * m[p][q]);
+        G4double t = (theta >= 0. ? 1. : -1.) /
+                     (std::abs(theta) + std::sqrt(theta * theta + 1.));
+        G4double c = 1. / std::sqrt(t * t + 1.);
+        G4double s = t * c;
+
+        for (size_t k = 0; k < 3; k++) {
+          G4double mkp = m[k][p], mkq = m[k][q];
+          m[k][p] = c * mkp - s * mkq;
+          m[k][q] = s * mkp + c * mkq;
+        }
+
+        for (size_t k = 0; k < 3; k++) {
+          G4double mpk = m[p][k], mqk = m[q][k];
+          m[p][k] = c * mpk - s * mqk;
+          m[q][k] = s * mpk + c * mqk;
+        }
+
+        for (size_t k = 0; k < 3; k++) {
+          G4double ekp = e[k][p], ekq = e[k][q];
+          e[k][p] = c * ekp - s * ekq;
+          e[k][q] = s * ekp + c * ekq;
+        }
+      }
+    }
+  }
+
+  size_t smallest = 0;
+  for (size_t i = 1; i < 3; i++) {
+    if (m[i][i] < m[smallest][smallest]) {
+      smallest = i;
+    }
+  }
+
+  G4ThreeVector normal(e[0][smallest], e[1][smallest], e[2][smallest]);
+
+  if (normal.mag2() == 0.) {
+    return false;
+  }
+
+  patch.kind = Patch::Plane;
+  patch.origin = centroid;
+  patch.axis = normal.unit();
+
+  return true;
+}
+
+inline G4bool Sphere(const Points &points, Patch &patch) {
+  if (points.size() < 4) {
+    return false;
+  }
+
+  // Algebraic fit of |p|^2 + D.p + G = 0 about the centroid.
+  auto centroid = Centroid(points);
+
+  G4double a[4][5] = {};
+  for (const auto &point : points) {
+    auto d = point - centroid;
+    G4double v[4] = {d.x(), d.y(), d.z(), 1.};
+    G4double r2 = d.mag2();
+
+    for (size_t i = 0; i < 4; i++) {
+      for (size_t j = 0; j < 4; j++) {
+        a[i][j] += v[i] * v[j];
+      }
+      a[i][4] -= v[i] * r2;
+    }
+  }
+
+  G4double x[4];
+  if (!Solve(a, x)) {
+    return false;
+  }
+
+  G4ThreeVector centre(-x[0] / 2., -x[1] / 2., -x[2] / 2.);
+  G4double radius2 = centre.mag2() - x[3];
+
+  if (radius2 <= 0.) {
+    return false;
+  }
+
+  patch.kind = Patch::Sphere;
+  patch.origin = centre + centroid;
+  patch.radius = std::sqrt(radius2);
+
+  return true;
+}
+
+inline G4bool Torus(const Points &points, Patch &patch) {
+  if (points.size() < 4) {
+    return false;
+  }
+
+  // About a fixed axis a torus is a circle in the (rho, h) half plane, so
+  // fit rho^2 + h^2 + D rho + E h + F = 0 about the mean (rho, h).
+  auto axis = patch.axis.unit();
+
+  std::vector<std::pair<G4double, G4double>> coordinates;
+  coordinates.reserve(points.size());
+
+  G4double rho_mean = 0., h_mean = 0.;
+  for (const auto &point : points) {
+    G4double h = point.dot(axis);
+    G4double rho = (point - h * axis).mag();
+
+    coordinates.emplace_back(rho, h);
+
+    rho_mean += rho;
+    h_mean += h;
+  }
+
+  rho_mean /= points.size();
+  h_mean /= points.size();
+
+  G4double a[3][4] = {};
+  for (const auto &coordinate : coordinates) {
+    G4double rho = coordinate.first - rho_mean;
+    G4double h = coordinate.second - h_mean;
+    G4double v[3] = {rho, h, 1.};
+    G4double r2 = rho * rho + h * h;
+
+    for (size_t i = 0; i < 3; i++) {
+      for (size_t j = 0; j < 3; j++) {
+        a[i][j] += v[i] * v[j];
+      }
+      a[i][3] -= v[i] * r2;
+    }
+  }
+
+  G4double x[3];
+  if (!Solve(a, x)) {
+    return false;
+  }
+
+  G4double minor_radius2 = (x[0] * x[0] + x[1] * x[1]) / 4. - x[2];
+
+  if (minor_radius2 <= 0.) {
+    return false;
+  }
+
+  patch.kind = Patch::Torus;
+  patch.axis = axis;
+  patch.origin = (h_mean - x[1] / 2.) * axis;
+  patch.radius = rho_mean - x[0] / 2.;
+  patch.minor_radius = std::sqrt(minor_radius2);
+
+  return patch.radius > 0.;
+}
+
+inline G4double Residual(const Patch &patch, const G4ThreeVector &point) {
+  auto d = point - patch.origin;
+
+  if (patch.kind == Patch::Plane) {
+    return std::abs(d.dot(patch.axis));
+  }
+
+  if (patch.kind == Patch::Sphere) {
+    return std::abs(d.mag() - patch.radius);
+  }
+
+  G4double h = d.dot(patch.axis);
+  G4double rho = (d - h * patch.axis).mag();
+
+  return std::abs(std::hypot(rho - patch.radius, h) - patch.minor_radius);
+}
+}
+
+inline Patches FindPatches(const WeldedMesh &mesh, G4double tolerance,
+                           G4ThreeVector torus_axis) {
+  const auto &vertices = mesh.vertices;
+  const auto &faces = mesh.triangles;
+
+  size_t face_count = faces.size();
+
+  // Facets are neighbours if they share a manifold edge.
+  std::vector<std::pair<std::pair<size_t, size_t>, size_t>> edges;
+  edges.reserve(3 * face_count);
+
+  std::vector<G4double> areas(face_count);
+
+  for (size_t f = 0; f < face_count; f++) {
+    auto &face = faces[f];
+
+    areas[f] = (vertices[face[1]] - vertices[face[0]])
+                   .cross(vertices[face[2]] - vertices[face[0]])
+                   .mag() /
+               2.;
+
+    for (size_t j = 0; j < 3; j++) {
+      size_t a = face[j], b = face[(j + 1) % 3];
+      edges.push_back({{std::min(a, b), std::max(a, b)}, f});
+    }
+  }
+
+  std::sort(edges.begin(), edges.end());
+
+  std::vector<std::vector<size_t>> neighbours(face_count);
+
+  for (size_t i = 0; i < edges.size();) {
+    size_t j = i;
+    while (j < edges.size() && edges[j].first == edges[i].first) {
+      j++;
+    }
+
+    if (j - i == 2) {
+      neighbours[edges[i].second].push_back(edges[i + 1].second);
+      neighbours[edges[i + 1].second].push_back(edges[i].second);
+    }
+
+    i = j;
+  }
+
+  std::vector<G4bool> assigned(face_count, false);
+
+  // Per-grow membership marks, so that nothing is cleared between regions.
+  std::vector<size_t> face_mark(face_count, 0);
+  std::vector<size_t> vertex_mark(vertices.size(), 0);
+  size_t mark = 0;
+
+  auto grow = [&](size_t seed, Patch::Kind kind) {
+    mark++;
+
+    Patch patch;
+    patch.axis = torus_axis;
+
+    Points points;
+
+    auto add = [&](size_t f) {
+      face_mark[f] = mark;
+      patch.facets.push_back(f);
+
+      for (auto v : faces[f]) {
+        if (vertex_mark[v] != mark) {
+          vertex_mark[v] = mark;
+          points.push_back(vertices[v]);
+        }
+      }
+    };
+
+    auto fits = [&](const Patch &candidate, const Points &candidate_points) {
+      for (const auto &point : candidate_points) {
+        if (Fit::Residual(candidate, point) > tolerance) {
+          return false;
+        }
+      }
+
+      return true;
+    };
+
+    auto fit = [&](Patch &candidate) {
+      if (kind == Patch::Plane) {
+        return Fit::Plane(points, candidate);
+      }
+
+      if (kind == Patch::Sphere) {
+        return Fit::Sphere(points, candidate);
+      }
+
+      return Fit::Torus(points, candidate);
+    };
+
+    add(seed);
+
+    // A plane is fixed by one facet; curved surfaces need the first ring.
+    if (kind != Patch::Plane) {
+      for (auto g : neighbours[seed]) {
+        if (!assigned[g]) {
+          add(g);
+        }
+      }
+    }
+
+    if (!fit(patch) || !fits(patch, points)) {
+      return Patch();
+    }
+
+    size_t fitted_points = points.size();
+
+    for (size_t i = 0; i < patch.facets.size(); i++) {
+      for (auto g : neighbours[patch.facets[i]]) {
+        if (assigned[g] || face_mark[g] == mark) {
+          continue;
+        }
+
+        auto &face = faces[g];
+
+        if (Fit::Residual(patch, vertices[face[0]]) > tolerance ||
+            Fit::Residual(patch, vertices[face[1]]) > tolerance ||
+            Fit::Residual(patch, vertices[face[2]]) > tolerance) {
+          continue;
+        }
+
+        add(g);
+
+        // Refit as the region doubles, keeping the new surface only if
+        // every point gathered so far still lies on it.
+        if (points.size() >= 2 * fitted_points) {
+          Patch refit = patch;
+
+          if (fit(refit) && fits(refit, points)) {
+            refit.facets = std::move(patch.facets);
+            patch = std::move(refit);
+          }
+
+          fitted_points = points.size();
+        }
+      }
+    }
+
+    for (const auto &point : points) {
+      patch.max_residual =
+          std::max(patch.max_residual, Fit::Residual(patch, point));
+    }
+
+    return patch;
+  };
+
+  Patches patches;
+
+  for (size_t seed = 0; seed < face_count; seed++) {
+    if (assigned[seed] || areas[seed] == 0.) {
+      continue;
+    }
+
+    Patch best;
+
+    for (auto kind : {Patch::Plane, Patch::Sphere, Patch::Torus}) {
+      auto patch = grow(seed, kind);
+
+      if (patch.facets.size() > best.facets.size()) {
+        best = std::move(patch);
+      }
+    }
+
+    // Even a single facet is a plane.
+    if (best.facets.empty()) {
+      best.facets.push_back(seed);
+      best.origin = vertices[faces[seed][0]];
+      best.axis = (vertices[faces[seed][1]] - vertices[faces[seed][0]])
+                      .cross(vertices[faces[seed][2]] - vertices[faces[seed][0]])
+                      .unit();
+    }
+
+    for (auto f : best.facets) {
+      assigned[f] = true;
+      best.area += areas[f];
+    }
+
+    patches.push_back(std::move(best));
+  }
+
+  // A seed next to a rim cannot fit a curved surface to its first ring, so
+  // small patches are left along the edges. Merge each into the largest
+  // neighbouring patch whose surface it also fits.
+  std::vector<size_t> patch_of(face_count, SIZE_MAX);
+  for (size_t p = 0; p < patches.size(); p++) {
+    for (auto f : patches[p].facets) {
+      patch_of[f] = p;
+    }
+  }
+
+  std::vector<size_t> order(patches.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return patches[a].facets.size() < patches[b].facets.size();
+  });
+
+  for (auto p : order) {
+    auto &patch = patches[p];
+
+    std::vector<size_t> adjacent;
+    for (auto f : patch.facets) {
+      for (auto g : neighbours[f]) {
+        if (patch_of[g] != p && patch_of[g] != SIZE_MAX) {
+          adjacent.push_back(patch_of[g]);
+        }
+      }
+    }
+
+    std::sort(adjacent.begin(), adjacent.end());
+    adjacent.erase(std::unique(adjacent.begin(), adjacent.end()),
+                   adjacent.end());
+    std::stable_sort(adjacent.begin(), adjacent.end(), [&](size_t a, size_t b) {
+      return patches[a].facets.size() > patches[b].facets.size();
+    });
+
+    for (auto q : adjacent) {
+      auto &target = patches[q];
+
+      if (target.facets.size() <= patch.facets.size()) {
+        break;
+      }
+
+      G4double residual = target.max_residual;
+      for (auto f : patch.facets) {
+        for (auto v : faces[f]) {
+          residual = std::max(residual, Fit::Residual(target, vertices[v]));
+        }
+      }
+
+      if (residual > tolerance) {
+        continue;
+      }
+
+      for (auto f : patch.facets) {
+        patch_of[f] = q;
+        target.facets.push_back(f);
+      }
+
+      target.area += patch.area;
+      target.max_residual = residual;
+
+      patch.facets.clear();
+      break;
+    }
+  }
+
+  patches.erase(std::remove_if(patches.begin(), patches.end(),
+                               [](const Patch &patch) {
+                                 return patch.facets.empty();
+                               }),
+                patches.end());
+
+  for (auto &patch : patches) {
+    std::sort(patch.facets.begin(), patch.facets.end());
+  }
+
+  return patches;
+}
+
+inline Patches Mesh::FindPatches(G4double tolerance, G4ThreeVector torus_axis) {
+  return CADMesh::FindPatches(Weld(), tolerance, torus_axis);
+}
+
+inline std::ostream &operator<<(std::ostream &stream, const Patch &patch) {
+  if (patch.kind == Patch::Plane) {
+    stream << "plane through " << patch.origin << " normal " << patch.axis;
+  }
+
+  else if (patch.kind == Patch::Sphere) {
+    stream << "sphere at " << patch.origin << " radius " << patch.radius;
+  }
+
+  else {
+    stream << "torus at " << patch.origin << " axis " << patch.axis
+           << " radii " << patch.radius << ", " << patch.minor_radius;
+  }
+
+  stream << ": " << patch.facets.size() << " facets, area " << patch.area
+         << ", max residual " << patch.max_residual;
+
+  return stream;
+}
+
+inline VertexWelder::VertexWelder(size_t expected_points, G4double tolerance)
+    : tolerance_(tolerance) {
+  size_t capacity = 16;
+
+  while (capacity < 2 * expected_points) {
+    capacity *= 2;
+  }
+
+  cells_.assign(capacity, Cell{0, 0, 0, SIZE_MAX});
+
+  vertices_.reserve(expected_points);
+  next_.reserve(expected_points);
+}
+
+inline void VertexWelder::CellOf(const G4ThreeVector &point, int64_t &x,
+                                 int64_t &y, int64_t &z) {
+  if (tolerance_ > 0.) {
+    x = int64_t(std::floor(point.x() / tolerance_));
+    y = int64_t(std::floor(point.y() / tolerance_));
+    z = int64_t(std::floor(point.z() / tolerance_));
+  }
+
+  else {
+    // Exact matching: the cell is the bit pattern itself. Adding zero turns
+    // -0 into +0 so that they end up in the same cell.
+    double coordinates[3] = {point.x() + 0., point.y() + 0., point.z() + 0.};
+
+    std::memcpy(&x, &coordinates[0], sizeof(x));
+    std::memcpy(&y, &coordinates[1], sizeof(y));
+    std::memcpy(&z, &coordinates[2], sizeof(z));
+  }
+}
+
+inline size_t VertexWelder::Slot(int64_t x, int64_t y, int64_t z) {
+  uint64_t hash = uint64_t(x) * 0x9E3779B97F4A7C15ULL;
+  hash = (hash ^ (hash >> 32)) + uint64_t(y) * 0xC2B2AE3D27D4EB4FULL;
+  hash = (hash ^ (hash >> 32)) + uint64_t(z) * 0x165667B19E3779F9ULL;
+  hash ^= hash >> 29;
+
+  size_t mask = cells_.size() - 1;
+  size_t slot = hash & mask;
+
+  while (cells_[slot].head != SIZE_MAX &&
+         (cells_[slot].x != x || cells_[slot].y != y || cells_[slot].z != z)) {
+    slot = (slot + 1) & mask;
+  }
+
+  return slot;
+}
+
+inline void VertexWelder::Grow() {
+  std::vector<Cell> cells;
+  cells.swap(cells_);
+
+  cells_.assign(2 * cells.size(), Cell{0, 0, 0, SIZE_MAX});
+
+  for (auto cell : cells) {
+    if (cell.head != SIZE_MAX) {
+      cells_[Slot(cell.x, cell.y, cell.z)] = cell;
+    }
+  }
+}
+
+inline size_t VertexWelder::Find(const G4ThreeVector &point) {
+  int64_t x, y, z;
+  CellOf(point, x, y, z);
+
+  if (tolerance_ > 0.) {
+    G4double tolerance2 = tolerance_ * tolerance_;
+
+    for (int64_t dx = -1; dx <= 1; dx++) {
+      for (int64_t dy = -1; dy <= 1; dy++) {
+        for (int64_t dz = -1; dz <= 1; dz++) {
+          auto &cell = cells_[Slot(x + dx, y + dy, z + dz)];
+
+          for (size_t i = cell.head; i != SIZE_MAX; i = next_[i]) {
+            if ((vertices_[i] - point).mag2() <= tolerance2) {
+              return i;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  else {
+    auto &cell = cells_[Slot(x, y, z)];
+
+    for (size_t i = cell.head; i != SIZE_MAX; i = next_[i]) {
+      if (vertices_[i] == point) {
+        return i;
+      }
+    }
+  }
+
+  return SIZE_MAX;
+}
+
+inline size_t VertexWelder::Add(const G4ThreeVector &point) {
+  size_t found = Find(point);
+  if (found != SIZE_MAX) {
+    return found;
+  }
+
+  int64_t x, y, z;
+  CellOf(point, x, y, z);
+
+  if (2 * (used_cells_ + 1) > cells_.size()) {
+    Grow();
+  }
+
+  auto &cell = cells_[Slot(x, y, z)];
+
+  if (cell.head == SIZE_MAX) {
+    cell.x = x;
+    cell.y = y;
+    cell.z = z;
+
+    used_cells_++;
+  }
+
+  size_t index = vertices_.size();
+
+  vertices_.push_back(point);
+  next_.push_back(cell.head);
+
+  cell.head = index;
+
+  return index;
+}
+
+inline Validation Validate(const WeldedMesh &mesh) {
+  Validation validation;
+
+  validation.facets = mesh.triangles.size();
+  validation.vertices = mesh.vertices.size();
+
+  if (validation.facets == 0) {
+    return validation;
+  }
+
+  // The edge packing below leaves 31 bits for the low vertex.
+  if (validation.vertices >= (1ULL << 31)) {
+    std::stringstream error;
+    error << "The mesh has " << validation.vertices
+          << " vertices; at most 2^31 can be validated.";
+    Exceptions::InvalidMesh("Validate", error.str());
+    return validation;
+  }
+
+  for (const auto &triangle : mesh.triangles) {
+    for (size_t j = 0; j < 3; j++) {
+      if (triangle[j] >= validation.vertices) {
+        std::stringstream error;
+        error << "A facet refers to vertex " << triangle[j] << " of "
+              << validation.vertices << ".";
+        Exceptions::InvalidMesh("Validate", error.str());
+        return validation;
+      }
+    }
+  }
+
+  // Split the work for large meshes. Edges are partitioned by their lowest
+  // vertex so that each partition can be sorted and counted independently.
+  size_t partitions = 1;
+
+  if (validation.facets > 100000) {
+    partitions = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  auto run = [partitions](std::function<void(size_t)> work) {
+    std::vector<std::thread> threads;
+
+    for (size_t p = 1; p < partitions; p++) {
+      threads.emplace_back(work, p);
+    }
+
+    work(0);
+
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  };
+
+  // Each edge is packed as (low vertex, high vertex, direction) so both uses
+  // of an edge sort next to each other.
+  typedef std::vector<uint64_t> Edges;
+
+  std::vector<std::vector<Edges>> buckets(partitions,
+                                          std::vector<Edges>(partitions));
+  std::vector<size_t> degenerate(partitions, 0);
+
+  size_t vertex_count = validation.vertices;
+
+  run([&](size_t t) {
+    size_t begin = validation.facets * t / partitions;
+    size_t end = validation.facets * (t + 1) / partitions;
+
+    for (auto &bucket : buckets[t]) {
+      bucket.reserve(3 * (end - begin) / partitions + 16);
+    }
+
+    for (size_t i = begin; i < end; i++) {
+      auto &triangle = mesh.triangles[i];
+
+      if (triangle[0] == triangle[1] || triangle[1] == triangle[2] ||
+          triangle[2] == triangle[0]) {
+        degenerate[t]++;
+        continue;
+      }
+
+      for (size_t j = 0; j < 3; j++) {
+        uint64_t a = triangle[j];
+        uint64_t b = triangle[(j + 1) % 3];
+
+        uint64_t low = std::min(a, b);
+        uint64_t edge = (low << 33) | (std::max(a, b) << 1) | (a > b ? 1 : 0);
+
+        buckets[t][low * partitions / vertex_count].push_back(edge);
+      }
+    }
+  });
+
+  std::vector<Validation> partial(partitions);
+  std::vector<Edges> open(partitions);
+
+  run([&](size_t p) {
+    Edges edges;
+
+    size_t size = 0;
+    for (size_t t = 0; t < partitions; t++) {
+      size += buckets[t][p].size();
+    }
+
+    edges.reserve(size);
+
+    for (size_t t = 0; t < partitions; t++) {
+      edges.insert(edges.end(), buckets[t][p].begin(), buckets[t][p].end());
+      Edges().swap(buckets[t][p]);
+    }
+
+    std::sort(edges.begin(), edges.end());
+
+    for (size_t i = 0; i < edges.size();) {
+      size_t j = i;
+      size_t reversed = 0;
+
+      while (j < edges.size() && (edges[j] >> 1) == (edges[i] >> 1)) {
+        reversed += edges[j] & 1;
+        j++;
+      }
+
+      size_t uses = j - i;
+
+      partial[p].edges++;
+
+      if (uses == 1) {
+        partial[p].boundary_edges++;
+        open[p].push_back(edges[i]);
+      }
+
+      else if (uses > 2) {
+        partial[p].non_manifold_edges++;
+      }
+
+      else if (reversed != 1) {
+        partial[p].flipped_edges++;
+      }
+
+      i = j;
+    }
+  });
+
+  for (size_t p = 0; p < partitions; p++) {
+    validation.edges += partial[p].edges;
+    validation.boundary_edges += partial[p].boundary_edges;
+    validation.non_manifold_edges += partial[p].non_manifold_edges;
+    validation.flipped_edges += partial[p].flipped_edges;
+    validation.degenerate_facets += degenerate[p];
+  }
+
+  // Group the open edges into connected components with a union-find over
+  // the vertices, joining by size so the trees stay shallow.
+  if (validation.boundary_edges > 0) {
+    std::vector<size_t> parent(vertex_count);
+    std::vector<size_t> size(vertex_count, 0);  // zero until seen on an edge
+
+    for (size_t v = 0; v < vertex_count; v++) {
+      parent[v] = v;
+    }
+
+    auto find = [&parent](size_t v) {
+      size_t root = v;
+
+      while (parent[root] != root) {
+        root = parent[root];
+      }
+
+      while (parent[v] != root) {
+        size_t next = parent[v];
+        parent[v] = root;
+        v = next;
+      }
+
+      return root;
+    };
+
+    for (const auto &edges : open) {
+      for (auto edge : edges) {
+        size_t a = find(edge >> 33);
+        size_t b = find((edge >> 1) & 0xffffffffULL);
+
+        size[a] = std::max<size_t>(size[a], 1);
+        size[b] = std::max<size_t>(size[b], 1);
+
+        if (a == b) {
+          continue;
+        }
+
+        if (size[a] < size[b]) {
+          std::swap(a, b);
+        }
+
+        parent[b] = a;
+        size[a] += size[b];
+      }
+    }
+
+    for (size_t v = 0; v < vertex_count; v++) {
+      if (size[v] > 0 && parent[v] == v) {
+        validation.boundary_components++;
+      }
+    }
+  }
+
+  return validation;
+}
+
+inline std::ostream &operator<<(std::ostream &stream,
+                                const Validation &validation) {
+  stream << validation.facets << " facets, " << validation.vertices
+         << " vertices, " << validation.edges << " edges; "
+         << validation.boundary_edges << " open edges in "
+         << validation.boundary_components << " boundaries, "
+         << validation.non_manifold_edges << " non-manifold edges, "
+         << validation.flipped_edges << " inconsistently oriented edges, "
+         << validation.degenerate_facets << " degenerate facets";
+
+  return stream;
+}
+}
+
+namespace CADMesh {
+
+namespace File {
+
+inline void MeshSink::BeginMesh(G4String name, size_t size) {
+  name_ = name;
+
+  triangles_.clear();
+  triangles_.reserve(size);
+}
+
+inline G4bool MeshSink::AddFacet(const G4ThreeVector &a,
+                                 const G4ThreeVector &b,
+                                 const G4ThreeVector &c) {
+  triangles_.push_back(new G4TriangularFacet(a, b, c, ABSOLUTE));
+
+  return true;
+}
+
+inline void MeshSink::EndMesh() {
+  meshes_.push_back(Mesh::New(std::move(triangles_), name_));
+  triangles_.clear();
+}
+
+inline void MeshSink::Discard() {
+  for (auto triangle : triangles_) {
+    delete triangle;
+  }
+
+  for (auto mesh : meshes_) {
+    for (auto triangle : mesh->GetTriangles()) {
+      delete triangle;
+    }
+  }
+
+  triangles_.clear();
+  meshes_.clear();
+}
+
+inline BoxFilter::BoxFilter(G4ThreeVector min, G4ThreeVector max,
+                            FacetSink &sink)
+    : min_(min), max_(max), sink_(sink) {}
+
+inline void BoxFilter::BeginMesh(G4String name, size_t size) {
+  sink_.BeginMesh(name, size);
+}
+
+inline G4bool BoxFilter::AddFacet(const G4ThreeVector &a,
+                                  const G4ThreeVector &b,
+                                  const G4ThreeVector &c) {
+  for (size_t i = 0; i < 3; i++) {
+    if (std::max({a[i], b[i], c[i]}) < min_[i] ||
+        std::min({a[i], b[i], c[i]}) > max_[i]) {
+      return true;
+    }
+  }
+
+  return sink_.AddFacet(a, b, c);
+}
+
+inline void BoxFilter::EndMesh() { sink_.EndMesh(); }
+
+inline WeldingSink::WeldingSink(G4double tolerance) : tolerance_(tolerance) {}
+
+inline void WeldingSink::BeginMesh(G4String name, size_t size) {
+  // A closed mesh has about half as many vertices as facets.
+  welder_.reset(new VertexWelder(size / 2, tolerance_));
+
+  triangles_.clear();
+  triangles_.reserve(size);
+
+  names_.push_back(name);
+}
+
+inline G4bool WeldingSink::AddFacet(const G4ThreeVector &a,
+                                    const G4ThreeVector &b,
+                                    const G4ThreeVector &c) {
+  triangles_.push_back(
+      IndexedTriangle{welder_->Add(a), welder_->Add(b), welder_->Add(c)});
+
+  return true;
+}
+
+inline void WeldingSink::EndMesh() {
+  WeldedMesh mesh;
+  mesh.vertices = std::move(welder_->GetVertices());
+  mesh.triangles = std::move(triangles_);
+
+  meshes_.push_back(std::move(mesh));
+
+  welder_.reset();
+  triangles_.clear();
+}
+
+// Counts the meshes started in the sink, so that a reader whose fast parser
+// gives up can tell whether it is still safe to start over with the lexer.
+class CountingSink : public FacetSink {
+public:
+  CountingSink(FacetSink &sink) : sink_(sink){};
+
+  void BeginMesh(G4String name, size_t size) {
+    meshes++;
+    sink_.BeginMesh(name, size);
+  };
+
+  G4bool AddFacet(const G4ThreeVector &a, const G4ThreeVector &b,
+                  const G4ThreeVector &c) {
+    return sink_.AddFacet(a, b, c);
+  };
+
+  void EndMesh() { sink_.EndMesh(); };
+
+  size_t meshes = 0;
+
+private:
+  FacetSink &sink_;
+};
+
+inline Reader::Reader(G4String reader_name) : name_(reader_name) {}
+
+inline Reader::~Reader() {}
+
+inline G4String Reader::GetName() { return name_; }
+
+inline std::shared_ptr<Mesh> Reader::GetMesh() {
+  if (meshes_.size() > 0) {
+    return meshes_[0];
+  }
+
+  return nullptr;
+}
+
+inline std::shared_ptr<Mesh> Reader::GetMesh(size_t index) {
+  if (index < meshes_.size()) {
+    return meshes_[index];
+  }
+
+  Exceptions::MeshNotFound("Reader::GetMesh", index);
+
+  return nullptr;
+}
+
+inline std::shared_ptr<Mesh> Reader::GetMesh(G4String name, G4bool exact) {
+  for (auto mesh : meshes_) {
+    if (exact) {
+      if (mesh->GetName() == name)
+        return mesh;
+    }
+
+    else {
+      if (mesh->GetName().find(name) != std::string::npos)
+        return mesh;
+    }
+  }
+
+  Exceptions::MeshNotFound("Reader::GetMesh", name);
+
+  return nullptr;
+}
+
+inline Meshes Reader::GetMeshes() { return meshes_; }
+
+inline size_t Reader::GetNumberOfMeshes() { return meshes_.size(); }
+
+inline size_t Reader::AddMesh(std::shared_ptr<Mesh> mesh) {
+  meshes_.push_back(mesh);
+
+  return meshes_.size();
+}
+
+inline void Reader::SetMeshes(Meshes meshes) { meshes_ = meshes; }
+
+inline G4bool Reader::Stream(G4String filepath, FacetSink &sink) {
+  // Keep the meshes of earlier reads out of the replay.
+  Meshes previous = std::move(meshes_);
+  meshes_.clear();
+
+  G4bool read = Read(filepath);
+
+  Meshes meshes = std::move(meshes_);
+  meshes_ = std::move(previous);
+
+  if (!read) {
+    return false;
+  }
+
+  for (auto mesh : meshes) {
+    auto triangles = mesh->GetTriangles();
+
+    sink.BeginMesh(mesh->GetName(), triangles.size());
+
+    for (auto triangle : triangles) {
+      if (!sink.AddFacet(triangle->GetVertex(0), triangle->GetVertex(1),
+                         triangle->GetVertex(2))) {
+        sink.EndMesh();
+        return true;
+      }
+    }
+
+    sink.EndMesh();
+  }
+
+  return true;
+}
+
+inline G4bool Reader::Stream(G4String filepath, FacetCallback callback) {
+  struct CallbackSink : public FacetSink {
+    FacetCallback callback;
+
+    G4bool AddFacet(const G4ThreeVector &a, const G4ThreeVector &b,
+                    const G4ThreeVector &c) {
+      return callback(a, b, c);
+    };
+  };
+
+  CallbackSink sink;
+  sink.callback = callback;
+
+  return Stream(filepath, sink);
+}
+}
+}
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <streambuf>
+
+namespace CADMesh {
+
+namespace File {
+
+inline Lexer::Lexer(std::string filepath, State *initial_state) {
+  std::ifstream file(filepath);
+  input_ = std::string((std::istreambuf_iterator<char>(file)),
+                       std::istreambuf_iterator<char>());
+
+  if (initial_state) {
+    Run(initial_state);
+  }
+}
+
+inline std::string Lexer::String() {
+  return input_.substr(start_, position_ - start_);
+}
+
+inline void Lexer::Run(State *initial_state, size_t lines) {
+  parent_item_ = new Item{ParentToken, position_,          line_, "", "",
+                          nullptr,     std::vector<Item>()};
+
+  state_ = initial_state;
+
+  end_line_ = 0;
+
+  if (lines > 0)
+    end_line_ = line_ + lines;
+
+  while (state_) {
+    state_ = (*state_)(this);
+  }
+}
+
+inline Items Lexer::GetItems() { return parent_item_->children; }
+
+inline void Lexer::Backup() {
+  position_ -= width_;
+
+  auto next = input_.substr(position_, 1);
+
+  if (next == "\n") {
+    line_--;
+  }
+}
+
+inline void Lexer::BackupTo(int position) {
+  auto s = input_.substr(position, position_ - position);
+  line_ -= std::count(s.begin(), s.end(), '\n');
+
+  position_ = position;
+}
 
 inline std::string Lexer::Next() {
   if (position_ >= input_.length()) {
@@ -1081,6 +2851,209 @@ inline void Lexer::PrintItem(Item) {}
 }
 }
 
+#ifdef CADMESH_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <array>
+#include <charconv>
+
+namespace CADMesh {
+
+namespace File {
+
+#ifdef CADMESH_USE_MMAP
+inline MappedFile::MappedFile(std::string filepath) {
+  int descriptor = open(filepath.c_str(), O_RDONLY);
+
+  if (descriptor < 0) {
+    return;
+  }
+
+  struct stat status;
+
+  if (fstat(descriptor, &status) == 0) {
+    size_ = status.st_size;
+    open_ = true;
+
+    if (size_ > 0) {
+      mapping_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+      if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        size_ = 0;
+        open_ = false;
+      }
+
+      else {
+        madvise(mapping_, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char *>(mapping_);
+      }
+    }
+  }
+
+  close(descriptor);
+}
+
+inline MappedFile::~MappedFile() {
+  if (mapping_) {
+    munmap(mapping_, size_);
+  }
+}
+#else
+inline MappedFile::MappedFile(std::string filepath) {
+  std::ifstream file(filepath, std::ios::binary);
+
+  if (!file) {
+    return;
+  }
+
+  buffer_ = std::vector<char>((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+
+  open_ = true;
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+}
+
+inline MappedFile::~MappedFile() {}
+#endif
+
+inline G4bool MappedFile::IsOpen() { return open_; }
+
+inline const char *MappedFile::Data() { return data_; }
+
+inline size_t MappedFile::Size() { return size_; }
+
+inline bool Scanner::AtEnd() { return position >= end; }
+
+inline bool Scanner::AtLineEnd() {
+  return AtEnd() || *position == '\n' || *position == '\r';
+}
+
+inline void Scanner::SkipBlanks() {
+  while (position < end && (*position == ' ' || *position == '\t')) {
+    position++;
+  }
+}
+
+inline void Scanner::SkipSpace() {
+  while (position < end && (*position == ' ' || *position == '\t' ||
+                            *position == '\r' || *position == '\n')) {
+    position++;
+  }
+}
+
+inline void Scanner::NextLine() {
+  auto line_end =
+      static_cast<const char *>(std::memchr(position, '\n', end - position));
+
+  position = line_end ? line_end + 1 : end;
+}
+
+inline bool Scanner::Keyword(const char *word) {
+  size_t length = std::strlen(word);
+
+  if (size_t(end - position) < length ||
+      std::memcmp(position, word, length) != 0) {
+    return false;
+  }
+
+  // The keyword must be followed by white space or the end of the input.
+  auto next = position + length;
+
+  if (next < end && !std::isspace(static_cast<unsigned char>(*next))) {
+    return false;
+  }
+
+  position = next;
+  SkipBlanks();
+
+  return true;
+}
+
+inline bool Scanner::ReadDouble(double &value) {
+  auto start = position;
+
+  // from_chars does not accept a leading '+'.
+  if (start < end && *start == '+') {
+    start++;
+  }
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  auto result = std::from_chars(start, end, value);
+
+  if (result.ec != std::errc() || result.ptr == start) {
+    return false;
+  }
+
+  position = result.ptr;
+#else
+  char buffer[64];
+  size_t length = 0;
+
+  while (start + length < end && length < sizeof(buffer) - 1 &&
+         std::strchr("0123456789+-.eE", start[length])) {
+    length++;
+  }
+
+  std::memcpy(buffer, start, length);
+  buffer[length] = '\0';
+
+  char *number_end = nullptr;
+  value = std::strtod(buffer, &number_end);
+
+  if (number_end == buffer) {
+    return false;
+  }
+
+  position = start + (number_end - buffer);
+#endif
+
+  SkipBlanks();
+  return true;
+}
+
+inline bool Scanner::ReadInteger(long &value) {
+  auto start = position;
+
+  if (start < end && *start == '+') {
+    start++;
+  }
+
+  auto result = std::from_chars(start, end, value);
+
+  if (result.ec != std::errc() || result.ptr == start) {
+    return false;
+  }
+
+  position = result.ptr;
+  return true;
+}
+
+inline std::string Scanner::ReadRestOfLine() {
+  SkipBlanks();
+
+  auto start = position;
+
+  while (!AtLineEnd()) {
+    position++;
+  }
+
+  auto stop = position;
+
+  while (stop > start && (stop[-1] == ' ' || stop[-1] == '\t')) {
+    stop--;
+  }
+
+  return std::string(start, stop);
+}
+}
+}
+
 namespace CADMesh {
 
 template <typename T>
@@ -1173,10 +3146,30 @@ CADMeshTemplate<T>::FromOBJ(G4String file_name,
   return std::make_shared<T>(file_name, File::OBJ, reader);
 }
 
-template <typename T> CADMeshTemplate<T>::~CADMeshTemplate() {}
-
-template <typename T> bool CADMeshTemplate<T>::IsValidForNavigation() {
-  return reader_->GetMesh()->IsValidForNavigation();
+template <typename T> CADMeshTemplate<T>::~CADMeshTemplate() {}
+
+template <typename T> std::shared_ptr<Mesh> CADMeshTemplate<T>::GetMesh() {
+  return reader_->GetMesh();
+}
+
+template <typename T>
+std::shared_ptr<Mesh> CADMeshTemplate<T>::GetMesh(G4int index) {
+  return reader_->GetMesh(index);
+}
+
+template <typename T> bool CADMeshTemplate<T>::IsValidForNavigation() {
+  return reader_->GetMesh()->IsValidForNavigation();
+}
+
+template <typename T>
+Validation CADMeshTemplate<T>::Validate(G4double tolerance) {
+  return reader_->GetMesh()->Validate(tolerance);
+}
+
+template <typename T>
+Patches CADMeshTemplate<T>::FindPatches(G4double tolerance,
+                                        G4ThreeVector torus_axis) {
+  return reader_->GetMesh()->FindPatches(tolerance, torus_axis);
 }
 
 template <typename T> G4String CADMeshTemplate<T>::GetFileName() {
@@ -1261,6 +3254,11 @@ inline void MeshNotFound(G4String origin, G4String name) {
       ("CADMesh in " + origin).c_str(), "MeshNotFound", FatalException,
       ("\nThe mesh with name '" + name + "' could not be found.").c_str());
 }
+
+inline void InvalidMesh(G4String origin, G4String message) {
+  G4Exception(("CADMesh in " + origin).c_str(), "InvalidMesh", FatalException,
+              ("\nThe mesh can't be validated:\n\t" + message).c_str());
+}
 }
 }
 
@@ -1329,30 +3327,883 @@ inline G4TessellatedSolid *
 TessellatedMesh::GetTessellatedSolid(std::shared_ptr<Mesh> mesh) {
   auto volume_solid = new G4TessellatedSolid(mesh->GetName());
 
-  for (auto triangle : mesh->GetTriangles()) {
-    auto a = triangle->GetVertex(0) * scale_ + offset_;
-    auto b = triangle->GetVertex(1) * scale_ + offset_;
-    auto c = triangle->GetVertex(2) * scale_ + offset_;
+  if (max_deviation_ > 0.) {
+    mesh = mesh->Decimate(max_deviation_ / scale_);
+  }
+
+  // Weld the shared vertices so that each one is scaled and offset once,
+  // and every facet that uses it gets exactly the same coordinates.
+  auto welded = mesh->Weld();
+
+  Points vertices;
+  vertices.reserve(welded.vertices.size());
+
+  for (const auto &vertex : welded.vertices) {
+    vertices.push_back(vertex * scale_ + offset_);
+  }
+
+  // Reversed meshes swap two corners instead of building a flipped copy.
+  size_t second = reverse_ ? 2 : 1;
+  size_t third = reverse_ ? 1 : 2;
+
+  for (const auto &triangle : welded.triangles) {
+    if (triangle[0] == triangle[1] || triangle[1] == triangle[2] ||
+        triangle[2] == triangle[0]) {
+      continue;
+    }
+
+    volume_solid->AddFacet(new G4TriangularFacet(vertices[triangle[0]],
+                                                 vertices[triangle[second]],
+                                                 vertices[triangle[third]],
+                                                 ABSOLUTE));
+  }
+
+  // The voxel limits must be set before the solid is closed, as closing it
+  // builds the voxelisation.
+  if (max_voxels_ > 0) {
+    volume_solid->SetMaxVoxels(max_voxels_);
+  }
+
+  else if (voxel_reduction_ratio_ != G4ThreeVector()) {
+    volume_solid->GetVoxels().SetMaxVoxels(voxel_reduction_ratio_);
+  }
+
+  volume_solid->SetSolidClosed(true);
+  if (volume_solid->GetNumberOfFacets() == 0) {
+    G4Exception("TessellatedMesh::GetTessellatedSolid",
+                "The loaded mesh has 0 faces.", FatalException,
+                "The file may be empty.");
+    return nullptr;
+  }
+  return volume_solid;
+}
+
+inline G4VSolid *TessellatedMesh::GetAnalyticSolid(G4double tolerance,
+                                                   Patches *found) {
+  return GetAnalyticSolid(reader_->GetMesh(), tolerance, found);
+}
+
+inline G4VSolid *
+TessellatedMesh::GetAnalyticSolid(std::shared_ptr<Mesh> mesh,
+                                  G4double tolerance, Patches *found) {
+  auto welded = mesh->Weld();
+  auto patches = CADMesh::FindPatches(welded, tolerance);
+
+  if (found) {
+    *found = patches;
+  }
+
+  const auto &vertices = welded.vertices;
+  const auto &faces = welded.triangles;
+
+  // Split the mesh into connected pieces.
+  std::vector<size_t> parent(vertices.size());
+  std::iota(parent.begin(), parent.end(), 0);
+
+  std::function<size_t(size_t)> find = [&](size_t v) {
+    while (parent[v] != v) {
+      v = parent[v] = parent[parent[v]];
+    }
+    return v;
+  };
+
+  for (const auto &face : faces) {
+    parent[find(face[1])] = find(face[0]);
+    parent[find(face[2])] = find(face[0]);
+  }
+
+  std::map<size_t, std::vector<size_t>> component_patches;
+  for (size_t p = 0; p < patches.size(); p++) {
+    component_patches[find(faces[patches[p].facets[0]][0])].push_back(p);
+  }
+
+  std::map<size_t, std::vector<size_t>> component_facets;
+  for (size_t f = 0; f < faces.size(); f++) {
+    component_facets[find(faces[f][0])].push_back(f);
+  }
+
+  auto vertex_set = [&](const Patch &patch) {
+    std::vector<size_t> set;
+    for (auto f : patch.facets) {
+      set.insert(set.end(), faces[f].begin(), faces[f].end());
+    }
+
+    std::sort(set.begin(), set.end());
+    set.erase(std::unique(set.begin(), set.end()), set.end());
+
+    return set;
+  };
+
+  // The facets outside the two main patches must only join them up.
+  auto only_rims = [&](const std::vector<size_t> &facets, const Patch &a,
+                       const Patch &b) {
+    auto va = vertex_set(a);
+    auto vb = vertex_set(b);
+
+    for (auto f : facets) {
+      for (auto v : faces[f]) {
+        if (!std::binary_search(va.begin(), va.end(), v) &&
+            !std::binary_search(vb.begin(), vb.end(), v)) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  };
+
+  // Smallest range of angles covering all of them, as (start, width).
+  auto angular_range = [](std::vector<G4double> angles) {
+    std::sort(angles.begin(), angles.end());
+
+    G4double gap = angles.front() + CLHEP::twopi - angles.back();
+    G4double start = angles.front();
+
+    for (size_t i = 1; i < angles.size(); i++) {
+      if (angles[i] - angles[i - 1] > gap) {
+        gap = angles[i] - angles[i - 1];
+        start = angles[i];
+      }
+    }
+
+    return std::make_pair(start, CLHEP::twopi - gap);
+  };
+
+  // The patch must fill the analytic region we replace it with. Chords make
+  // the mesh a little smaller than the surface it follows.
+  auto same_area = [](G4double mesh_area, G4double analytic_area) {
+    return std::abs(mesh_area - analytic_area) <= 0.02 * analytic_area;
+  };
+
+  auto rotation_to = [](const G4ThreeVector &axis) {
+    G4RotationMatrix rotation;
+    rotation.rotateY(axis.theta());
+    rotation.rotateZ(axis.phi());
+    return rotation;
+  };
+
+  G4String name = mesh->GetName();
+  auto mesh_triangles = mesh->GetTriangles();
+
+  struct Piece {
+    G4VSolid *solid;
+    G4Transform3D transform;
+  };
+
+  // A G4GenericTrap from the corners of its two parallel faces, each face
+  // in order around it and the second straight across from the first.
+  // Repeating a corner makes a triangular one.
+  auto generic_trap = [&](const std::array<G4ThreeVector, 4> &lower,
+                          const std::array<G4ThreeVector, 4> &upper,
+                          G4ThreeVector axis, const G4String &cell_name) {
+    G4double low = 0., high = 0.;
+    G4ThreeVector centre;
+
+    for (size_t k = 0; k < 4; k++) {
+      low += lower[k].dot(axis) / 4.;
+      high += upper[k].dot(axis) / 4.;
+      centre += (lower[k] + upper[k]) / 8.;
+    }
+
+    if (high < low) {
+      axis = -axis;
+      low = -low;
+      high = -high;
+    }
+
+    centre += ((low + high) / 2. - centre.dot(axis)) * axis;
+
+    auto rotation = rotation_to(axis);
+    auto u = rotation * G4ThreeVector(1, 0, 0);
+    auto w = rotation * G4ThreeVector(0, 1, 0);
+
+    std::vector<G4TwoVector> corners;
+    for (auto face : {&lower, &upper}) {
+      for (const auto &corner : *face) {
+        auto d = corner - centre;
+        corners.emplace_back(d.dot(u) * scale_, d.dot(w) * scale_);
+      }
+    }
+
+    // G4GenericTrap wants both faces clockwise.
+    G4double signed_area = 0.;
+    for (size_t k = 0; k < 4; k++) {
+      auto &p = corners[k];
+      auto &q = corners[(k + 1) % 4];
+      signed_area += p.x() * q.y() - q.x() * p.y();
+    }
+
+    if (signed_area > 0.) {
+      std::swap(corners[1], corners[3]);
+      std::swap(corners[5], corners[7]);
+    }
+
+    return Piece{new G4GenericTrap(cell_name, (high - low) / 2. * scale_,
+                                   corners),
+                 G4Transform3D(rotation, centre * scale_ + offset_)};
+  };
+
+  // A piece swept along a fixed vector, like the ruled segments of a
+  // faceted mirror: every vertex has a partner one sweep away, the back
+  // facets are the front ones moved along the sweep and the side facets
+  // join the front outline to the back one. Neighbouring front facets are
+  // paired into quads, and each quad, swept, is a G4GenericTrap: one with
+  // opposite edges of the quad on its parallel faces, which lets the quad
+  // twist by up to the tolerance, or else one with a flat quad as its
+  // faces. Facets that can't be paired are swept into triangular ones. No
+  // cells are returned if the piece is not a sweep.
+  auto sweep_cells = [&](const std::vector<size_t> &facets,
+                         const G4String &piece_name) {
+    std::vector<Piece> cells;
+
+    std::vector<size_t> piece_vertices;
+    for (auto f : facets) {
+      piece_vertices.insert(piece_vertices.end(), faces[f].begin(),
+                            faces[f].end());
+    }
+
+    std::sort(piece_vertices.begin(), piece_vertices.end());
+    piece_vertices.erase(
+        std::unique(piece_vertices.begin(), piece_vertices.end()),
+        piece_vertices.end());
+
+    size_t n = piece_vertices.size();
+    if (n < 6 || n % 2 != 0 || tolerance <= 0.) {
+      return cells;
+    }
+
+    auto position = [&](size_t v) {
+      return size_t(std::lower_bound(piece_vertices.begin(),
+                                     piece_vertices.end(), v) -
+                    piece_vertices.begin());
+    };
+
+    VertexWelder lookup(n, tolerance);
+    for (size_t i = 0; i < n; i++) {
+      if (lookup.Add(vertices[piece_vertices[i]]) != i) {
+        return cells;
+      }
+    }
+
+    // The sweep is along one of the edges of any vertex.
+    std::vector<G4ThreeVector> sweeps;
+    for (auto f : facets) {
+      for (size_t j = 0; j < 3; j++) {
+        if (faces[f][j] == piece_vertices[0]) {
+          for (size_t k = 1; k < 3; k++) {
+            sweeps.push_back(vertices[faces[f][(j + k) % 3]] -
+                             vertices[piece_vertices[0]]);
+          }
+        }
+      }
+    }
+
+    for (const auto &sweep : sweeps) {
+      // The partner of each front vertex, and the front vertex of each back
+      // one.
+      std::vector<size_t> ahead(n, SIZE_MAX), behind(n, SIZE_MAX);
+      G4bool matched = true;
+
+      for (size_t i = 0; matched && i < n; i++) {
+        auto point = vertices[piece_vertices[i]];
+        ahead[i] = lookup.Find(point + sweep);
+        behind[i] = lookup.Find(point - sweep);
+        matched = (ahead[i] == SIZE_MAX) != (behind[i] == SIZE_MAX);
+      }
+
+      if (!matched) {
+        continue;
+      }
+
+      std::vector<std::array<size_t, 3>> front;
+      std::vector<std::array<size_t, 3>> back, sides;
+
+      for (auto f : facets) {
+        std::array<size_t, 3> facet = {position(faces[f][0]),
+                                       position(faces[f][1]),
+                                       position(faces[f][2])};
+        size_t in_front = 0;
+        for (auto i : facet) {
+          in_front += ahead[i] != SIZE_MAX;
+        }
+
+        if (in_front == 3) {
+          front.push_back(facet);
+        } else if (in_front == 0) {
+          back.push_back(facet);
+        } else {
+          sides.push_back(facet);
+        }
+      }
+
+      // The back must be the front moved along the sweep.
+      auto sorted = [](std::array<size_t, 3> facet) {
+        std::sort(facet.begin(), facet.end());
+        return facet;
+      };
+
+      std::set<std::array<size_t, 3>> moved;
+      for (const auto &facet : front) {
+        moved.insert(sorted({ahead[facet[0]], ahead[facet[1]],
+                             ahead[facet[2]]}));
+      }
+
+      matched = !front.empty() && back.size() == front.size();
+      for (size_t b = 0; matched && b < back.size(); b++) {
+        matched = moved.count(sorted(back[b])) > 0;
+      }
+
+      // Each edge of the front joins two of its facets, or it is on the
+      // outline, and each side facet spans an outline edge and its partner.
+      std::map<std::pair<size_t, size_t>, std::vector<size_t>> edges;
+      for (size_t t = 0; t < front.size(); t++) {
+        for (size_t j = 0; j < 3; j++) {
+          size_t u = front[t][j], w = front[t][(j + 1) % 3];
+          edges[{std::min(u, w), std::max(u, w)}].push_back(t);
+        }
+      }
+
+      size_t outline = 0;
+      for (const auto &edge : edges) {
+        matched = matched && edge.second.size() <= 2;
+        outline += edge.second.size() == 1;
+      }
+
+      matched = matched && sides.size() == 2 * outline;
+      for (size_t s = 0; matched && s < sides.size(); s++) {
+        std::vector<size_t> spanned;
+        for (auto i : sides[s]) {
+          spanned.push_back(ahead[i] != SIZE_MAX ? i : behind[i]);
+        }
+
+        std::sort(spanned.begin(), spanned.end());
+        spanned.erase(std::unique(spanned.begin(), spanned.end()),
+                      spanned.end());
+
+        auto edge = edges.find({spanned.front(), spanned.back()});
+        matched = spanned.size() == 2 && edge != edges.end() &&
+                  edge->second.size() == 1;
+      }
+
+      if (!matched) {
+        continue;
+      }
+
+      // Pair the front facets, a facet with a single unpaired neighbour
+      // first, so that a strip pairs up from its ends.
+      std::vector<std::vector<size_t>> neighbours(front.size());
+      for (const auto &edge : edges) {
+        if (edge.second.size() == 2) {
+          neighbours[edge.second[0]].push_back(edge.second[1]);
+          neighbours[edge.second[1]].push_back(edge.second[0]);
+        }
+      }
+
+      std::vector<size_t> mate(front.size(), SIZE_MAX);
+      std::vector<size_t> unpaired(front.size());
+      std::queue<size_t> leaves;
+
+      for (size_t t = 0; t < front.size(); t++) {
+        unpaired[t] = neighbours[t].size();
+        if (unpaired[t] == 1) {
+          leaves.push(t);
+        }
+      }
+
+      auto pair = [&](size_t a, size_t b) {
+        mate[a] = b;
+        mate[b] = a;
+
+        for (auto t : {a, b}) {
+          for (auto neighbour : neighbours[t]) {
+            if (mate[neighbour] == SIZE_MAX && --unpaired[neighbour] == 1) {
+              leaves.push(neighbour);
+            }
+          }
+        }
+      };
+
+      auto first_unpaired = [&](size_t t) {
+        for (auto neighbour : neighbours[t]) {
+          if (mate[neighbour] == SIZE_MAX) {
+            return neighbour;
+          }
+        }
+        return SIZE_MAX;
+      };
+
+      for (size_t start = 0; start < front.size(); start++) {
+        while (!leaves.empty()) {
+          size_t t = leaves.front();
+          leaves.pop();
+
+          size_t other = mate[t] == SIZE_MAX ? first_unpaired(t) : SIZE_MAX;
+          if (other != SIZE_MAX) {
+            pair(t, other);
+          }
+        }
+
+        // A loop of facets with no ends is broken anywhere.
+        size_t other = mate[start] == SIZE_MAX ? first_unpaired(start)
+                                               : SIZE_MAX;
+        if (other != SIZE_MAX) {
+          pair(start, other);
+        }
+      }
+
+      auto at = [&](size_t i) -> const G4ThreeVector & {
+        return vertices[piece_vertices[i]];
+      };
+
+      auto prism = [&](const std::array<size_t, 3> &facet) {
+        auto normal = (at(facet[1]) - at(facet[0]))
+                          .cross(at(facet[2]) - at(facet[0]))
+                          .unit();
+
+        return generic_trap(
+            {at(facet[0]), at(facet[1]), at(facet[2]), at(facet[2])},
+            {at(ahead[facet[0]]), at(ahead[facet[1]]), at(ahead[facet[2]]),
+             at(ahead[facet[2]])},
+            normal, piece_name + "_" + std::to_string(cells.size()));
+      };
+
+      // A flat, convex quad swept with its front and back as the parallel
+      // faces.
+      auto flat = [&](const std::array<size_t, 4> &corners) {
+        auto normal = (at(corners[2]) - at(corners[0]))
+                          .cross(at(corners[3]) - at(corners[1]));
+
+        if (normal.mag2() == 0.) {
+          return false;
+        }
+
+        normal = normal.unit();
+
+        for (size_t k = 0; k < 4; k++) {
+          auto &a = at(corners[k]);
+          auto &b = at(corners[(k + 1) % 4]);
+          auto &c = at(corners[(k + 2) % 4]);
+
+          if (std::abs((a - at(corners[0])).dot(normal)) > tolerance ||
+              (b - a).cross(c - b).dot(normal) <= 0.) {
+            return false;
+          }
+        }
+
+        if (std::abs(sweep.dot(normal)) <= tolerance) {
+          return false;
+        }
+
+        cells.push_back(generic_trap(
+            {at(corners[0]), at(corners[1]), at(corners[2]), at(corners[3])},
+            {at(ahead[corners[0]]), at(ahead[corners[1]]),
+             at(ahead[corners[2]]), at(ahead[corners[3]])},
+            normal, piece_name + "_" + std::to_string(cells.size())));
+        return true;
+      };
+
+      // A twisted quad p, q, t, s swept with p-q and s-t on the parallel
+      // faces.
+      auto quad = [&](size_t p, size_t q, size_t t, size_t s) {
+        auto axis = sweep.cross(at(q) - at(p));
+        auto normal = (at(q) - at(p)).cross(at(t) - at(p));
+
+        if (axis.mag() <= tolerance * sweep.mag() || normal.mag2() == 0.) {
+          return false;
+        }
+
+        axis = axis.unit();
+
+        if (std::abs((at(t) - at(s)).dot(axis)) > tolerance ||
+            std::abs((at(s) - at(p)).dot(axis)) <= tolerance ||
+            std::abs((at(s) - at(p)).dot(normal.unit())) > 4. * tolerance) {
+          return false;
+        }
+
+        cells.push_back(generic_trap(
+            {at(p), at(q), at(ahead[q]), at(ahead[p])},
+            {at(s), at(t), at(ahead[t]), at(ahead[s])}, axis,
+            piece_name + "_" + std::to_string(cells.size())));
+        return true;
+      };
+
+      for (size_t t = 0; matched && t < front.size(); t++) {
+        if (mate[t] == SIZE_MAX) {
+          matched = std::abs(sweep.dot((at(front[t][1]) - at(front[t][0]))
+                                           .cross(at(front[t][2]) -
+                                                  at(front[t][0]))
+                                           .unit())) > tolerance;
+          if (matched) {
+            cells.push_back(prism(front[t]));
+          }
+          continue;
+        }
+
+        if (mate[t] < t) {
+          continue;
+        }
+
+        // Turn t so that its edge x-y is the one shared with its mate, whose
+        // third corner e closes the quad x, e, y, z.
+        auto facet = front[t];
+        auto &other = front[mate[t]];
+        for (size_t r = 0;
+             r < 3 && std::count(other.begin(), other.end(), facet[2]) > 0;
+             r++) {
+          std::rotate(facet.begin(), facet.begin() + 1, facet.end());
+        }
+
+        size_t x = facet[0], y = facet[1], z = facet[2];
+        size_t e = other[0] + other[1] + other[2] - x - y;
+
+        // A twist can put either pair of opposite edges on the faces.
+        if (!quad(x, e, y, z) && !quad(e, y, z, x) && !flat({x, e, y, z})) {
+          for (auto half : {facet, other}) {
+            matched = matched &&
+                      std::abs(sweep.dot((at(half[1]) - at(half[0]))
+                                             .cross(at(half[2]) - at(half[0]))
+                                             .unit())) > tolerance;
+            if (matched) {
+              cells.push_back(prism(half));
+            }
+          }
+        }
+      }
+
+      if (matched) {
+        return cells;
+      }
+
+      for (auto &cell : cells) {
+        delete cell.solid;
+      }
+      cells.clear();
+    }
+
+    return cells;
+  };
+
+  std::vector<Piece> pieces;
+  size_t analytic_pieces = 0;
+
+  for (auto &component : component_facets) {
+    auto &facets = component.second;
+    auto &indices = component_patches[component.first];
+
+    std::vector<const Patch *> planes, spheres, tori;
+    for (auto p : indices) {
+      if (patches[p].kind == Patch::Plane) {
+        planes.push_back(&patches[p]);
+      } else if (patches[p].kind == Patch::Sphere) {
+        spheres.push_back(&patches[p]);
+      } else {
+        tori.push_back(&patches[p]);
+      }
+    }
+
+    auto by_area = [](const Patch *a, const Patch *b) {
+      return a->area > b->area;
+    };
+
+    std::sort(planes.begin(), planes.end(), by_area);
+    std::sort(spheres.begin(), spheres.end(), by_area);
+    std::sort(tori.begin(), tori.end(), by_area);
+
+    G4String piece_name = name + "_" + std::to_string(pieces.size());
+    G4VSolid *solid = nullptr;
+    G4Transform3D transform;
+
+    // The rest of each shape is made of rims joining the two main patches,
+    // whatever surfaces those rims happen to fit.
+    auto partner = [](const std::vector<const Patch *> &candidates,
+                      std::function<G4bool(const Patch &)> matches) {
+      for (size_t i = 1; i < candidates.size(); i++) {
+        if (matches(*candidates[i])) {
+          return candidates[i];
+        }
+      }
+      return (const Patch *)nullptr;
+    };
+
+    // A slab: two parallel planar faces joined by sides normal to them,
+    // i.e. an extruded polygon.
+    const Patch *back = nullptr;
+    if (planes.size() >= 2) {
+      back = partner(planes, [&](const Patch &b) {
+        return std::abs(b.axis.dot(planes[0]->axis)) >= 1. - 1e-9;
+      });
+    }
+
+    if (!solid && back) {
+      auto &a = *planes[0];
+      auto &b = *back;
+
+      auto va = vertex_set(a);
+      auto vb = vertex_set(b);
+
+      G4double near = DBL_MAX, far = -DBL_MAX;
+      for (auto v : vb) {
+        G4double d = (vertices[v] - a.origin).dot(a.axis);
+        near = std::min(near, d);
+        far = std::max(far, d);
+      }
+
+      G4double thickness = (near + far) / 2.;
+      auto direction = thickness > 0. ? a.axis : -a.axis;
+      thickness = std::abs(thickness);
+
+      // Every vertex of the far face must sit straight across from one of
+      // the near face, and the near face must have a single outline.
+      VertexWelder projected(va.size() + vb.size(), tolerance);
+      for (auto v : va) {
+        projected.Add(vertices[v]);
+      }
+
+      G4bool matched = far - near <= 2. * tolerance && thickness > tolerance &&
+                       va.size() == vb.size() && only_rims(facets, a, b);
+
+      for (size_t i = 0; matched && i < vb.size(); i++) {
+        matched = projected.Add(vertices[vb[i]] - thickness * direction) <
+                  va.size();
+      }
+
+      std::map<size_t, size_t> outline;
+      std::map<std::pair<size_t, size_t>, int> uses;
+
+      for (auto f : a.facets) {
+        for (size_t j = 0; j < 3; j++) {
+          size_t u = faces[f][j], w = faces[f][(j + 1) % 3];
+          uses[{std::min(u, w), std::max(u, w)}]++;
+        }
+      }
+
+      for (auto f : a.facets) {
+        for (size_t j = 0; j < 3; j++) {
+          size_t u = faces[f][j], w = faces[f][(j + 1) % 3];
+          if (uses[{std::min(u, w), std::max(u, w)}] == 1) {
+            matched = matched && outline.emplace(u, w).second;
+          }
+        }
+      }
+
+      std::vector<size_t> loop;
+      if (matched && !outline.empty()) {
+        size_t v = outline.begin()->first;
+        do {
+          loop.push_back(v);
+          auto next = outline.find(v);
+          if (next == outline.end()) {
+            break;
+          }
+          v = next->second;
+        } while (v != loop.front() && loop.size() <= outline.size());
+      }
+
+      if (matched && loop.size() == outline.size() && loop.size() >= 3) {
+        auto rotation = rotation_to(direction);
+        auto u = rotation * G4ThreeVector(1, 0, 0);
+        auto w = rotation * G4ThreeVector(0, 1, 0);
+
+        G4ThreeVector centre;
+        for (auto v : loop) {
+          centre += vertices[v];
+        }
+        centre /= G4double(loop.size());
+
+        // Drop points that lie on a straight run of the outline.
+        std::vector<G4TwoVector> polygon;
+        for (size_t i = 0; i < loop.size(); i++) {
+          auto previous = vertices[loop[(i + loop.size() - 1) % loop.size()]];
+          auto current = vertices[loop[i]];
+          auto next = vertices[loop[(i + 1) % loop.size()]];
+
+          G4double bend = (current - previous).cross(next - current).mag() /
+                          (next - previous).mag();
+
+          if (bend > tolerance) {
+            auto d = current - centre;
+            polygon.emplace_back(d.dot(u) * scale_, d.dot(w) * scale_);
+          }
+        }
+
+        // G4ExtrudedSolid wants the outline clockwise.
+        G4double signed_area = 0.;
+        for (size_t i = 0; i < polygon.size(); i++) {
+          auto &p = polygon[i];
+          auto &q = polygon[(i + 1) % polygon.size()];
+          signed_area += p.x() * q.y() - q.x() * p.y();
+        }
+
+        if (signed_area > 0.) {
+          std::reverse(polygon.begin(), polygon.end());
+        }
+
+        if (polygon.size() >= 3) {
+          solid = new G4ExtrudedSolid(piece_name, polygon,
+                                      thickness / 2. * scale_);
+
+          transform = G4Transform3D(
+              rotation,
+              (centre + thickness / 2. * direction) * scale_ + offset_);
+        }
+      }
+    }
+
+    // A spherical shell cut along lines of latitude and longitude.
+    if (!solid && !spheres.empty()) {
+      auto outer = spheres[0];
+      auto inner = partner(spheres, [&](const Patch &b) {
+        return (b.origin - outer->origin).mag() <= tolerance;
+      });
+
+      if (inner && inner->radius > outer->radius) {
+        std::swap(inner, outer);
+      }
+
+      G4bool matched = inner ? only_rims(facets, *outer, *inner)
+                             : facets.size() == outer->facets.size();
+
+      std::vector<G4double> phis;
+      G4double theta_min = CLHEP::pi, theta_max = 0.;
+
+      for (auto f : facets) {
+        for (auto v : faces[f]) {
+          auto d = vertices[v] - outer->origin;
+          phis.push_back(d.phi());
+          theta_min = std::min(theta_min, d.theta());
+          theta_max = std::max(theta_max, d.theta());
+        }
+      }
+
+      // A closed sphere covers every angle, however it is sampled.
+      auto phi = std::make_pair(0., CLHEP::twopi);
+
+      if (inner) {
+        phi = angular_range(phis);
+      }
+
+      else {
+        theta_min = 0.;
+        theta_max = CLHEP::pi;
+      }
+
+      auto area = [&](G4double radius) {
+        return radius * radius * phi.second *
+               (std::cos(theta_min) - std::cos(theta_max));
+      };
+
+      matched = matched && same_area(outer->area, area(outer->radius));
+      if (inner) {
+        matched = matched && same_area(inner->area, area(inner->radius));
+      }
+
+      if (matched) {
+        solid = new G4Sphere(piece_name, inner ? inner->radius * scale_ : 0.,
+                             outer->radius * scale_, phi.first, phi.second,
+                             theta_min, theta_max - theta_min);
+
+        transform =
+            G4Transform3D(G4RotationMatrix(), outer->origin * scale_ + offset_);
+      }
+    }
+
+    // A toroidal shell cut at two azimuths.
+    if (!solid && !tori.empty()) {
+      auto outer = tori[0];
+      auto inner = partner(tori, [&](const Patch &b) {
+        return (b.origin - outer->origin).mag() <= tolerance &&
+               std::abs(b.radius - outer->radius) <= tolerance;
+      });
+
+      if (inner && inner->minor_radius > outer->minor_radius) {
+        std::swap(inner, outer);
+      }
+
+      G4bool matched = inner ? only_rims(facets, *outer, *inner)
+                             : facets.size() == outer->facets.size();
+
+      auto rotation = rotation_to(outer->axis);
+      auto u = rotation * G4ThreeVector(1, 0, 0);
+      auto w = rotation * G4ThreeVector(0, 1, 0);
+
+      std::vector<G4double> phis;
+      for (auto f : facets) {
+        for (auto v : faces[f]) {
+          auto d = vertices[v] - outer->origin;
+          phis.push_back(std::atan2(d.dot(w), d.dot(u)));
+        }
+      }
+
+      auto phi = inner ? angular_range(phis)
+                       : std::make_pair(0., CLHEP::twopi);
+
+      auto area = [&](G4double minor_radius) {
+        return CLHEP::twopi * outer->radius * minor_radius * phi.second;
+      };
+
+      matched = matched && same_area(outer->area, area(outer->minor_radius));
+      if (inner) {
+        matched = matched && same_area(inner->area, area(inner->minor_radius));
+      }
+
+      if (matched) {
+        solid = new G4Torus(
+            piece_name, inner ? inner->minor_radius * scale_ : 0.,
+            outer->minor_radius * scale_, outer->radius * scale_, phi.first,
+            phi.second);
+
+        transform = G4Transform3D(rotation, outer->origin * scale_ + offset_);
+      }
+    }
+
+    std::vector<Piece> cells;
+    if (!solid) {
+      cells = sweep_cells(facets, piece_name);
+    }
 
-    auto t = new G4TriangularFacet(a, b, c, ABSOLUTE);
+    if (!cells.empty()) {
+      analytic_pieces += cells.size();
+      pieces.insert(pieces.end(), cells.begin(), cells.end());
+      continue;
+    }
 
-    if (reverse_) {
-      volume_solid->AddFacet((G4VFacet *)t->GetFlippedFacet());
+    if (solid) {
+      analytic_pieces++;
     }
 
+    // Anything else stays tessellated.
     else {
-      volume_solid->AddFacet((G4VFacet *)t);
+      Triangles triangles;
+      for (auto f : facets) {
+        triangles.push_back(mesh_triangles[f]);
+      }
+
+      solid = GetTessellatedSolid(Mesh::New(triangles, piece_name));
+      transform = G4Transform3D();
     }
+
+    pieces.push_back({solid, transform});
   }
 
-  volume_solid->SetSolidClosed(true);
-  if (volume_solid->GetNumberOfFacets() == 0) {
-    G4Exception("TessellatedMesh::GetTessellatedSolid",
-                "The loaded mesh has 0 faces.", FatalException,
-                "The file may be empty.");
-    return nullptr;
+  if (analytic_pieces == 0) {
+    for (auto &piece : pieces) {
+      delete piece.solid;
+    }
+
+    return GetTessellatedSolid(mesh);
   }
-  return volume_solid;
+
+  if (pieces.size() == 1) {
+    return new G4DisplacedSolid(name, pieces[0].solid, pieces[0].transform);
+  }
+
+  auto compound = new G4MultiUnion(name);
+  for (auto &piece : pieces) {
+    compound->AddNode(*piece.solid, piece.transform);
+  }
+  compound->Voxelize();
+
+  return compound;
 }
 }
 
@@ -1558,6 +4409,9 @@ public:
   G4bool Read(G4String filepath);
   G4bool CanRead(Type file_type);
 
+  using Reader::Stream;
+  G4bool Stream(G4String filepath, FacetSink &sink);
+
 protected:
   CADMeshLexerStateDefinition(StartSolid);
   CADMeshLexerStateDefinition(EndSolid);
@@ -1572,11 +4426,23 @@ protected:
 
   CADMeshLexerStateDefinition(ThreeVector);
 
-  std::shared_ptr<Mesh> ParseMesh(Items items);
-  G4TriangularFacet *ParseFacet(Items items);
-  G4TriangularFacet *ParseVertices(Items items);
-  G4ThreeVector ParseThreeVector(Items items);
+  std::shared_ptr<Mesh> ParseMesh(const Items &items);
+  G4TriangularFacet *ParseFacet(const Items &items);
+  G4TriangularFacet *ParseVertices(const Items &items);
+  G4ThreeVector ParseThreeVector(const Items &items);
+
+  G4bool IsBinary(const char *data, size_t size);
+  G4bool ParseBinary(const char *data, size_t size, FacetSink &sink);
+  G4bool ParseASCII(const char *data, size_t size, FacetSink &sink);
 };
+
+// Binary STL layout: an 80 byte header, a little endian uint32 facet count
+// and then 50 bytes per facet (normal, 3 vertices as float32 and a uint16
+// attribute byte count).
+static const size_t BinarySTLHeaderSize = 80;
+static const size_t BinarySTLFacetSize = 50;
+
+G4bool WriteBinarySTL(G4String filepath, std::shared_ptr<Mesh> mesh);
 }
 }
 
@@ -1591,6 +4457,9 @@ public:
   G4bool Read(G4String filepath);
   G4bool CanRead(Type file_type);
 
+  using Reader::Stream;
+  G4bool Stream(G4String filepath, FacetSink &sink);
+
 protected:
   CADMeshLexerStateDefinition(StartSolid);
   CADMeshLexerStateDefinition(EndSolid);
@@ -1600,9 +4469,11 @@ protected:
   CADMeshLexerStateDefinition(Facet);
   CADMeshLexerStateDefinition(Object);
 
-  std::shared_ptr<Mesh> ParseMesh(Items items);
-  G4ThreeVector ParseVertex(Items items);
-  G4TriangularFacet *ParseFacet(Items items, G4bool quad);
+  std::shared_ptr<Mesh> ParseMesh(const Items &items);
+  G4ThreeVector ParseVertex(const Items &items);
+  G4TriangularFacet *ParseFacet(const Items &items, G4bool quad);
+
+  G4bool ParseASCII(const char *data, size_t size, FacetSink &sink);
 
 private:
   Points vertices_;
@@ -1625,6 +4496,9 @@ public:
   G4bool Read(G4String filepath);
   G4bool CanRead(Type file_type);
 
+  using Reader::Stream;
+  G4bool Stream(G4String filepath, FacetSink &sink);
+
 protected:
   CADMeshLexerStateDefinition(StartHeader);
   CADMeshLexerStateDefinition(EndHeader);
@@ -1636,11 +4510,13 @@ protected:
   CADMeshLexerStateDefinition(Vertex);
   CADMeshLexerStateDefinition(Facet);
 
-  void ParseHeader(Items items);
+  void ParseHeader(const Items &items);
 
-  std::shared_ptr<Mesh> ParseMesh(Items vertex_items, Items face_items);
-  G4ThreeVector ParseVertex(Items items);
-  G4TriangularFacet *ParseFacet(Items items, Points vertices);
+  std::shared_ptr<Mesh> ParseMesh(const Items &vertex_items, const Items &face_items);
+  G4ThreeVector ParseVertex(const Items &items);
+  G4TriangularFacet *ParseFacet(const Items &items, const Points &vertices);
+
+  G4bool ParseASCII(const char *data, size_t size, FacetSink &sink);
 
   size_t vertex_count_ = 0;
   size_t facet_count_ = 0;
@@ -1803,6 +4679,31 @@ inline State *STLReader::CADMeshLexerState(ThreeVector) {
 }
 
 inline G4bool STLReader::Read(G4String filepath) {
+  MappedFile file(filepath);
+
+  if (!file.IsOpen()) {
+    Exceptions::FileNotFound("STLReader::Read", filepath);
+    return false;
+  }
+
+  MeshSink sink;
+
+  G4bool parsed = IsBinary(file.Data(), file.Size())
+                      ? ParseBinary(file.Data(), file.Size(), sink)
+                      : ParseASCII(file.Data(), file.Size(), sink);
+
+  if (parsed) {
+    for (auto mesh : sink.GetMeshes()) {
+      AddMesh(mesh);
+    }
+
+    return true;
+  }
+
+  sink.Discard();
+
+  // The fast parser only accepts well formed files. Let the lexer have a go,
+  // it reports where the syntax is wrong.
   auto items = RunLexer(filepath, StartSolid);
 
   if (items.size() == 0) {
@@ -1810,7 +4711,7 @@ inline G4bool STLReader::Read(G4String filepath) {
                             "The STL file appears to be empty.");
   }
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     if (item.children.size() == 0) {
       std::stringstream error;
       error << "The mesh appears to be empty."
@@ -1830,10 +4731,41 @@ inline G4bool STLReader::Read(G4String filepath) {
 
 inline G4bool STLReader::CanRead(Type file_type) { return (file_type == STL); }
 
-inline std::shared_ptr<Mesh> STLReader::ParseMesh(Items items) {
+inline G4bool STLReader::Stream(G4String filepath, FacetSink &sink) {
+  {
+    MappedFile file(filepath);
+
+    if (!file.IsOpen()) {
+      Exceptions::FileNotFound("STLReader::Stream", filepath);
+      return false;
+    }
+
+    if (IsBinary(file.Data(), file.Size())) {
+      return ParseBinary(file.Data(), file.Size(), sink);
+    }
+
+    CountingSink counter(sink);
+
+    if (ParseASCII(file.Data(), file.Size(), counter)) {
+      return true;
+    }
+
+    // Facets that already reached the sink cannot be taken back.
+    if (counter.meshes > 0) {
+      Exceptions::ParserError("STLReader::Stream",
+                              "The STL file is not well formed. Read it with "
+                              "STLReader::Read to find the error.");
+      return false;
+    }
+  }
+
+  return Reader::Stream(filepath, sink);
+}
+
+inline std::shared_ptr<Mesh> STLReader::ParseMesh(const Items &items) {
   Triangles triangles;
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     if (item.children.size() == 0) {
       std::stringstream error;
       error << "The facet appears to be empty."
@@ -1848,10 +4780,10 @@ inline std::shared_ptr<Mesh> STLReader::ParseMesh(Items items) {
   return Mesh::New(triangles);
 }
 
-inline G4TriangularFacet *STLReader::ParseFacet(Items items) {
+inline G4TriangularFacet *STLReader::ParseFacet(const Items &items) {
   Triangles triangles;
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     if (item.children.size() == 0) {
       std::stringstream error;
       error << "The vertex appears to be empty."
@@ -1877,10 +4809,10 @@ inline G4TriangularFacet *STLReader::ParseFacet(Items items) {
   return triangles[0];
 }
 
-inline G4TriangularFacet *STLReader::ParseVertices(Items items) {
+inline G4TriangularFacet *STLReader::ParseVertices(const Items &items) {
   std::vector<G4ThreeVector> vertices;
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     if (item.children.size() == 0) {
       std::stringstream error;
       error << "The vertex appears to be empty."
@@ -1906,10 +4838,10 @@ inline G4TriangularFacet *STLReader::ParseVertices(Items items) {
   return new G4TriangularFacet(vertices[0], vertices[1], vertices[2], ABSOLUTE);
 }
 
-inline G4ThreeVector STLReader::ParseThreeVector(Items items) {
+inline G4ThreeVector STLReader::ParseThreeVector(const Items &items) {
   std::vector<double> numbers;
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     numbers.push_back((double)atof(item.value.c_str()));
   }
 
@@ -1926,6 +4858,243 @@ inline G4ThreeVector STLReader::ParseThreeVector(Items items) {
 
   return G4ThreeVector(numbers[0], numbers[1], numbers[2]);
 }
+
+inline uint32_t ReadLittleEndianUInt32(const char *data) {
+  auto bytes = reinterpret_cast<const unsigned char *>(data);
+
+  return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) |
+         (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+}
+
+inline float ReadLittleEndianFloat(const char *data) {
+  uint32_t bits = ReadLittleEndianUInt32(data);
+
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+
+  return value;
+}
+
+inline void WriteLittleEndianUInt32(char *data, uint32_t value) {
+  data[0] = char(value & 0xff);
+  data[1] = char((value >> 8) & 0xff);
+  data[2] = char((value >> 16) & 0xff);
+  data[3] = char((value >> 24) & 0xff);
+}
+
+inline void WriteLittleEndianFloat(char *data, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  WriteLittleEndianUInt32(data, bits);
+}
+
+inline G4bool STLReader::IsBinary(const char *data, size_t size) {
+  if (size < BinarySTLHeaderSize + 4) {
+    return false;
+  }
+
+  // A binary file has exactly the size implied by its facet count. Some
+  // exporters start the binary header with 'solid' too, so the size is
+  // checked first.
+  size_t facet_count = ReadLittleEndianUInt32(data + BinarySTLHeaderSize);
+
+  if (size == BinarySTLHeaderSize + 4 + facet_count * BinarySTLFacetSize) {
+    return true;
+  }
+
+  return std::string(data, 5) != "solid";
+}
+
+inline G4bool STLReader::ParseBinary(const char *data, size_t size,
+                                     FacetSink &sink) {
+  if (size < BinarySTLHeaderSize + 4) {
+    Exceptions::ParserError("STLReader::ParseBinary",
+                            "The binary STL file is missing its header.");
+  }
+
+  size_t facet_count = ReadLittleEndianUInt32(data + BinarySTLHeaderSize);
+
+  if (size < BinarySTLHeaderSize + 4 + facet_count * BinarySTLFacetSize) {
+    std::stringstream error;
+    error << "The binary STL file is truncated. The header lists "
+          << facet_count << " facets.";
+
+    Exceptions::ParserError("STLReader::ParseBinary", error.str());
+  }
+
+  if (facet_count == 0) {
+    Exceptions::ParserError("STLReader::ParseBinary",
+                            "The STL file appears to be empty.");
+  }
+
+  sink.BeginMesh("", facet_count);
+
+  auto facet = data + BinarySTLHeaderSize + 4;
+
+  for (size_t i = 0; i < facet_count; i++) {
+    // Skip the normal, Geant4 recomputes it from the vertices.
+    auto vertex = facet + 12;
+
+    G4ThreeVector points[3];
+
+    for (size_t j = 0; j < 3; j++) {
+      points[j].set(ReadLittleEndianFloat(vertex),
+                    ReadLittleEndianFloat(vertex + 4),
+                    ReadLittleEndianFloat(vertex + 8));
+      vertex += 12;
+    }
+
+    if (!sink.AddFacet(points[0], points[1], points[2])) {
+      break;
+    }
+
+    facet += BinarySTLFacetSize;
+  }
+
+  sink.EndMesh();
+
+  return true;
+}
+
+inline G4bool STLReader::ParseASCII(const char *data, size_t size,
+                                    FacetSink &sink) {
+  Scanner scanner{data, data + size};
+
+  // Seven lines per facet in a conventionally formatted file.
+  size_t facet_estimate = std::count(data, data + size, '\n') / 7 + 1;
+
+  size_t mesh_count = 0;
+
+  scanner.SkipSpace();
+
+  while (!scanner.AtEnd()) {
+    if (!scanner.Keyword("solid")) {
+      return false;
+    }
+
+    sink.BeginMesh(scanner.ReadRestOfLine(), facet_estimate);
+
+    size_t facet_count = 0;
+
+    while (true) {
+      scanner.SkipSpace();
+
+      if (scanner.Keyword("endsolid")) {
+        scanner.NextLine();
+        break;
+      }
+
+      if (!scanner.Keyword("facet")) {
+        return false;
+      }
+
+      scanner.NextLine();
+      scanner.SkipSpace();
+
+      if (!scanner.Keyword("outer")) {
+        return false;
+      }
+
+      scanner.NextLine();
+
+      G4ThreeVector points[3];
+
+      for (size_t i = 0; i < 3; i++) {
+        scanner.SkipSpace();
+
+        double x, y, z;
+
+        if (!scanner.Keyword("vertex") || !scanner.ReadDouble(x) ||
+            !scanner.ReadDouble(y) || !scanner.ReadDouble(z)) {
+          return false;
+        }
+
+        points[i].set(x, y, z);
+      }
+
+      scanner.SkipSpace();
+
+      if (!scanner.Keyword("endloop")) {
+        return false;
+      }
+
+      scanner.SkipSpace();
+
+      if (!scanner.Keyword("endfacet")) {
+        return false;
+      }
+
+      facet_count++;
+
+      if (!sink.AddFacet(points[0], points[1], points[2])) {
+        sink.EndMesh();
+        return true;
+      }
+    }
+
+    if (facet_count == 0) {
+      return false;
+    }
+
+    sink.EndMesh();
+    mesh_count++;
+
+    scanner.SkipSpace();
+  }
+
+  return mesh_count > 0;
+}
+
+inline G4bool WriteBinarySTL(G4String filepath, std::shared_ptr<Mesh> mesh) {
+  std::ofstream file(filepath, std::ios::binary);
+
+  if (!file) {
+    Exceptions::FileNotFound("WriteBinarySTL", filepath);
+    return false;
+  }
+
+  auto triangles = mesh->GetTriangles();
+
+  // The header must not start with 'solid', or readers may mistake the file
+  // for ASCII.
+  std::vector<char> data(BinarySTLHeaderSize + 4 +
+                             triangles.size() * BinarySTLFacetSize,
+                         0);
+
+  std::string header = "CADMesh binary STL " + mesh->GetName();
+  std::copy_n(header.begin(), std::min(header.size(), BinarySTLHeaderSize),
+              data.begin());
+
+  WriteLittleEndianUInt32(data.data() + BinarySTLHeaderSize,
+                          uint32_t(triangles.size()));
+
+  auto facet = data.data() + BinarySTLHeaderSize + 4;
+
+  for (auto triangle : triangles) {
+    G4ThreeVector a = triangle->GetVertex(0);
+    G4ThreeVector b = triangle->GetVertex(1);
+    G4ThreeVector c = triangle->GetVertex(2);
+
+    G4ThreeVector normal = (b - a).cross(c - a).unit();
+
+    G4ThreeVector vectors[4] = {normal, a, b, c};
+
+    auto value = facet;
+    for (auto v : vectors) {
+      WriteLittleEndianFloat(value, float(v.x()));
+      WriteLittleEndianFloat(value + 4, float(v.y()));
+      WriteLittleEndianFloat(value + 8, float(v.z()));
+      value += 12;
+    }
+
+    facet += BinarySTLFacetSize;
+  }
+
+  file.write(data.data(), data.size());
+
+  return file.good();
+}
 }
 }
 
@@ -2082,6 +5251,31 @@ inline State *OBJReader::CADMeshLexerState(Object) {
 }
 
 inline G4bool OBJReader::Read(G4String filepath) {
+  {
+    MappedFile file(filepath);
+
+    if (!file.IsOpen()) {
+      Exceptions::FileNotFound("OBJReader::Read", filepath);
+      return false;
+    }
+
+    MeshSink sink;
+
+    if (ParseASCII(file.Data(), file.Size(), sink)) {
+      for (auto mesh : sink.GetMeshes()) {
+        AddMesh(mesh);
+      }
+
+      return true;
+    }
+
+    sink.Discard();
+  }
+
+  // The fast parser only accepts well formed files. Let the lexer have a go,
+  // it reports where the syntax is wrong.
+  vertices_.clear();
+
   auto items = RunLexer(filepath, StartSolid);
 
   if (items.size() == 0) {
@@ -2089,7 +5283,7 @@ inline G4bool OBJReader::Read(G4String filepath) {
                             "The OBJ file appears to be empty.");
   }
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     if (item.children.size() == 0) {
       continue;
     }
@@ -2114,10 +5308,37 @@ inline G4bool OBJReader::Read(G4String filepath) {
 
 inline G4bool OBJReader::CanRead(Type file_type) { return (file_type == OBJ); }
 
-inline std::shared_ptr<Mesh> OBJReader::ParseMesh(Items items) {
+inline G4bool OBJReader::Stream(G4String filepath, FacetSink &sink) {
+  {
+    MappedFile file(filepath);
+
+    if (!file.IsOpen()) {
+      Exceptions::FileNotFound("OBJReader::Stream", filepath);
+      return false;
+    }
+
+    CountingSink counter(sink);
+
+    if (ParseASCII(file.Data(), file.Size(), counter)) {
+      return true;
+    }
+
+    // Facets that already reached the sink cannot be taken back.
+    if (counter.meshes > 0) {
+      Exceptions::ParserError("OBJReader::Stream",
+                              "The OBJ file is not well formed. Read it with "
+                              "OBJReader::Read to find the error.");
+      return false;
+    }
+  }
+
+  return Reader::Stream(filepath, sink);
+}
+
+inline std::shared_ptr<Mesh> OBJReader::ParseMesh(const Items &items) {
   Triangles facets;
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     if (item.token != VertexToken) {
       continue;
     }
@@ -2133,7 +5354,7 @@ inline std::shared_ptr<Mesh> OBJReader::ParseMesh(Items items) {
     vertices_.push_back(ParseVertex(item.children));
   }
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     if (item.token != FacetToken) {
       continue;
     }
@@ -2153,13 +5374,175 @@ inline std::shared_ptr<Mesh> OBJReader::ParseMesh(Items items) {
     }
   }
 
-  return Mesh::New(facets);
+  return Mesh::New(facets);
+}
+
+inline G4bool OBJReader::ParseASCII(const char *data, size_t size,
+                                    FacetSink &sink) {
+  Scanner scanner{data, data + size};
+
+  // Count the vertex lines first so nothing is reallocated.
+  size_t vertex_count = 0;
+
+  while (!scanner.AtEnd()) {
+    scanner.SkipBlanks();
+
+    if (scanner.Keyword("v")) {
+      vertex_count++;
+    }
+
+    scanner.NextLine();
+  }
+
+  vertices_.clear();
+  vertices_.reserve(vertex_count);
+
+  // Facets can refer to vertices that appear later in the same object. Those
+  // are held back until the object is complete; the rest go straight to the
+  // sink.
+  typedef std::array<size_t, 3> Indices;
+  std::vector<Indices> deferred;
+
+  G4String name;
+
+  size_t mesh_count = 0;
+
+  G4bool in_mesh = false;
+  G4bool stopped = false;
+
+  auto add_facet = [&](const Indices &index) {
+    if (!in_mesh) {
+      sink.BeginMesh(name, 0);
+      in_mesh = true;
+    }
+
+    return sink.AddFacet(vertices_[index[0]], vertices_[index[1]],
+                         vertices_[index[2]]);
+  };
+
+  auto finish_object = [&]() {
+    for (auto index : deferred) {
+      if (index[0] >= vertices_.size() || index[1] >= vertices_.size() ||
+          index[2] >= vertices_.size()) {
+        return false;
+      }
+    }
+
+    for (size_t i = 0; i < deferred.size() && !stopped; i++) {
+      stopped = !add_facet(deferred[i]);
+    }
+
+    deferred.clear();
+
+    if (in_mesh) {
+      sink.EndMesh();
+      mesh_count++;
+      in_mesh = false;
+    }
+
+    return true;
+  };
+
+  std::vector<long> polygon;
+
+  scanner.position = data;
+
+  while (!scanner.AtEnd()) {
+    scanner.SkipBlanks();
+
+    if (scanner.Keyword("v")) {
+      double x, y, z;
+
+      if (!scanner.ReadDouble(x) || !scanner.ReadDouble(y) || !scanner.ReadDouble(z)) {
+        return false;
+      }
+
+      vertices_.emplace_back(x, y, z);
+    }
+
+    else if (scanner.Keyword("f")) {
+      polygon.clear();
+
+      while (!scanner.AtLineEnd()) {
+        long index;
+
+        if (!scanner.ReadInteger(index)) {
+          return false;
+        }
+
+        // Skip the texture and normal indices.
+        while (!scanner.AtLineEnd() && *scanner.position == '/') {
+          scanner.position++;
+
+          long ignored;
+          scanner.ReadInteger(ignored);
+        }
+
+        // Negative indices count back from the last vertex read.
+        if (index < 0) {
+          index += vertices_.size();
+        }
+
+        else {
+          index -= 1;
+        }
+
+        if (index < 0) {
+          return false;
+        }
+
+        polygon.push_back(index);
+        scanner.SkipBlanks();
+      }
+
+      if (polygon.size() < 3) {
+        return false;
+      }
+
+      G4bool known = size_t(*std::max_element(polygon.begin(), polygon.end())) <
+                     vertices_.size();
+
+      for (size_t i = 1; i + 1 < polygon.size(); i++) {
+        Indices index{size_t(polygon[0]), size_t(polygon[i]),
+                      size_t(polygon[i + 1])};
+
+        if (!known) {
+          deferred.push_back(index);
+        }
+
+        else if (!add_facet(index)) {
+          sink.EndMesh();
+          return true;
+        }
+      }
+    }
+
+    else if (scanner.Keyword("o")) {
+      if (!finish_object()) {
+        return false;
+      }
+
+      if (stopped) {
+        return true;
+      }
+
+      name = scanner.ReadRestOfLine();
+    }
+
+    scanner.NextLine();
+  }
+
+  if (!finish_object()) {
+    return false;
+  }
+
+  return mesh_count > 0;
 }
 
-inline G4ThreeVector OBJReader::ParseVertex(Items items) {
+inline G4ThreeVector OBJReader::ParseVertex(const Items &items) {
   std::vector<double> numbers;
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     numbers.push_back((double)atof(item.value.c_str()));
   }
 
@@ -2177,10 +5560,10 @@ inline G4ThreeVector OBJReader::ParseVertex(Items items) {
   return G4ThreeVector(numbers[0], numbers[1], numbers[2]);
 }
 
-inline G4TriangularFacet *OBJReader::ParseFacet(Items items, G4bool quad) {
+inline G4TriangularFacet *OBJReader::ParseFacet(const Items &items, G4bool quad) {
   std::vector<int> indices;
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     indices.push_back((int)atoi(item.value.c_str()));
   }
 
@@ -2382,6 +5765,29 @@ inline State *PLYReader::CADMeshLexerState(Facet) {
 }
 
 inline G4bool PLYReader::Read(G4String filepath) {
+  {
+    MappedFile file(filepath);
+
+    if (!file.IsOpen()) {
+      Exceptions::FileNotFound("PLYReader::Read", filepath);
+      return false;
+    }
+
+    MeshSink sink;
+
+    if (ParseASCII(file.Data(), file.Size(), sink)) {
+      for (auto mesh : sink.GetMeshes()) {
+        AddMesh(mesh);
+      }
+
+      return true;
+    }
+
+    sink.Discard();
+  }
+
+  // The fast parser only accepts well formed ASCII files. Let the lexer have
+  // a go, it reports where the syntax is wrong.
   auto lexer = Lexer(filepath, new StartHeaderState);
   auto items = lexer.GetItems();
 
@@ -2428,7 +5834,34 @@ inline G4bool PLYReader::Read(G4String filepath) {
 
 inline G4bool PLYReader::CanRead(Type file_type) { return (file_type == PLY); }
 
-inline void PLYReader::ParseHeader(Items items) {
+inline G4bool PLYReader::Stream(G4String filepath, FacetSink &sink) {
+  {
+    MappedFile file(filepath);
+
+    if (!file.IsOpen()) {
+      Exceptions::FileNotFound("PLYReader::Stream", filepath);
+      return false;
+    }
+
+    CountingSink counter(sink);
+
+    if (ParseASCII(file.Data(), file.Size(), counter)) {
+      return true;
+    }
+
+    // Facets that already reached the sink cannot be taken back.
+    if (counter.meshes > 0) {
+      Exceptions::ParserError("PLYReader::Stream",
+                              "The PLY file is not well formed. Read it with "
+                              "PLYReader::Read to find the error.");
+      return false;
+    }
+  }
+
+  return Reader::Stream(filepath, sink);
+}
+
+inline void PLYReader::ParseHeader(const Items &items) {
   if (items.size() != 1) {
     std::stringstream error;
     error << "The header appears to be invalid or missing."
@@ -2437,7 +5870,7 @@ inline void PLYReader::ParseHeader(Items items) {
     Exceptions::ParserError("PLYReader::ParseHeader", error.str());
   }
 
-  for (auto item : items[0].children) {
+  for (const auto &item : items[0].children) {
     if (item.token == ElementToken) {
       if (item.children.size() < 2) {
         std::stringstream error;
@@ -2454,7 +5887,7 @@ inline void PLYReader::ParseHeader(Items items) {
           vertex_count_ = atoi(item.children[1].value.c_str());
 
           for (size_t i = 2; i < item.children.size(); i++) {
-            auto property = item.children[i];
+            const auto &property = item.children[i];
 
             if (property.children.size() > 1) {
               if (property.children[1].token == WordToken) {
@@ -2478,7 +5911,7 @@ inline void PLYReader::ParseHeader(Items items) {
           facet_count_ = atoi(item.children[1].value.c_str());
 
           for (size_t i = 2; i < item.children.size(); i++) {
-            auto property = item.children[i];
+            const auto &property = item.children[i];
 
             if (property.children.size() > 1) {
               if (property.children[1].token == WordToken) {
@@ -2516,12 +5949,12 @@ inline void PLYReader::ParseHeader(Items items) {
   }
 }
 
-inline std::shared_ptr<Mesh> PLYReader::ParseMesh(Items vertex_items,
-                                                  Items face_items) {
+inline std::shared_ptr<Mesh> PLYReader::ParseMesh(const Items &vertex_items,
+                                                  const Items &face_items) {
   Points vertices;
   Triangles facets;
 
-  for (auto item : vertex_items) {
+  for (const auto &item : vertex_items) {
     if (item.children.size() == 0) {
       std::stringstream error;
       error << "The vertex appears to be empty."
@@ -2535,7 +5968,7 @@ inline std::shared_ptr<Mesh> PLYReader::ParseMesh(Items vertex_items,
     }
   }
 
-  for (auto item : face_items) {
+  for (const auto &item : face_items) {
     if (item.children.size() == 0) {
       std::stringstream error;
       error << "The facet appears to be empty."
@@ -2552,10 +5985,213 @@ inline std::shared_ptr<Mesh> PLYReader::ParseMesh(Items vertex_items,
   return Mesh::New(facets);
 }
 
-inline G4ThreeVector PLYReader::ParseVertex(Items items) {
+inline G4bool PLYReader::ParseASCII(const char *data, size_t size,
+                                    FacetSink &sink) {
+  Scanner scanner{data, data + size};
+
+  struct Property {
+    std::string name;
+    bool list;
+  };
+
+  struct Element {
+    std::string name;
+    size_t count;
+    std::vector<Property> properties;
+  };
+
+  std::vector<Element> elements;
+
+  if (!scanner.Keyword("ply")) {
+    return false;
+  }
+
+  scanner.NextLine();
+
+  while (true) {
+    scanner.SkipSpace();
+
+    if (scanner.AtEnd()) {
+      return false;
+    }
+
+    if (scanner.Keyword("end_header")) {
+      scanner.NextLine();
+      break;
+    }
+
+    if (scanner.Keyword("format")) {
+      if (!scanner.Keyword("ascii")) {
+        return false;
+      }
+    }
+
+    else if (scanner.Keyword("element")) {
+      std::istringstream element(scanner.ReadRestOfLine());
+
+      Element e;
+      element >> e.name >> e.count;
+
+      if (!element) {
+        return false;
+      }
+
+      elements.push_back(e);
+    }
+
+    else if (scanner.Keyword("property")) {
+      if (elements.size() == 0) {
+        return false;
+      }
+
+      std::istringstream property(scanner.ReadRestOfLine());
+
+      std::string type, word;
+      property >> type;
+
+      Property p{"", type == "list"};
+
+      while (property >> word) {
+        p.name = word;
+      }
+
+      elements.back().properties.push_back(p);
+    }
+
+    scanner.NextLine();
+  }
+
+  Points vertices;
+
+  size_t facet_count = 0;
+  G4bool in_mesh = false;
+
+  std::vector<double> values;
+  std::vector<size_t> polygon;
+
+  for (const auto &element : elements) {
+    bool is_vertex = element.name == "vertex";
+    bool is_face = element.name == "face";
+
+    size_t x = 0, y = 0, z = 0;
+
+    if (is_vertex) {
+      for (size_t i = 0; i < element.properties.size(); i++) {
+        if (element.properties[i].list) {
+          return false;
+        }
+
+        if (element.properties[i].name == "x") {
+          x = i;
+        }
+
+        else if (element.properties[i].name == "y") {
+          y = i;
+        }
+
+        else if (element.properties[i].name == "z") {
+          z = i;
+        }
+      }
+
+      if (x == y || y == z || x == z) {
+        return false;
+      }
+
+      vertices.reserve(element.count);
+      values.resize(element.properties.size());
+    }
+
+    if (is_face && !in_mesh) {
+      sink.BeginMesh("", element.count);
+      in_mesh = true;
+    }
+
+    for (size_t n = 0; n < element.count; n++) {
+      scanner.SkipSpace();
+
+      if (!is_vertex && !is_face) {
+        scanner.NextLine();
+        continue;
+      }
+
+      if (is_vertex) {
+        for (auto &value : values) {
+          if (!scanner.ReadDouble(value)) {
+            return false;
+          }
+        }
+
+        vertices.emplace_back(values[x], values[y], values[z]);
+        continue;
+      }
+
+      polygon.clear();
+
+      for (const auto &property : element.properties) {
+        double value;
+
+        if (!property.list) {
+          if (!scanner.ReadDouble(value)) {
+            return false;
+          }
+
+          continue;
+        }
+
+        if (!scanner.ReadDouble(value)) {
+          return false;
+        }
+
+        size_t length = size_t(value);
+
+        bool is_indices = property.name == "vertex_indices" ||
+                          property.name == "vertex_index";
+
+        for (size_t i = 0; i < length; i++) {
+          if (!scanner.ReadDouble(value)) {
+            return false;
+          }
+
+          if (is_indices) {
+            if (value < 0 || size_t(value) >= vertices.size()) {
+              return false;
+            }
+
+            polygon.push_back(size_t(value));
+          }
+        }
+      }
+
+      if (polygon.size() < 3) {
+        return false;
+      }
+
+      for (size_t i = 1; i + 1 < polygon.size(); i++) {
+        facet_count++;
+
+        if (!sink.AddFacet(vertices[polygon[0]], vertices[polygon[i]],
+                           vertices[polygon[i + 1]])) {
+          sink.EndMesh();
+          return true;
+        }
+      }
+    }
+  }
+
+  if (vertices.size() == 0 || facet_count == 0) {
+    return false;
+  }
+
+  sink.EndMesh();
+
+  return true;
+}
+
+inline G4ThreeVector PLYReader::ParseVertex(const Items &items) {
   std::vector<double> numbers;
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     numbers.push_back((double)atof(item.value.c_str()));
   }
 
@@ -2573,10 +6209,11 @@ inline G4ThreeVector PLYReader::ParseVertex(Items items) {
   return G4ThreeVector(numbers[x_index_], numbers[y_index_], numbers[z_index_]);
 }
 
-inline G4TriangularFacet *PLYReader::ParseFacet(Items items, Points vertices) {
+inline G4TriangularFacet *PLYReader::ParseFacet(const Items &items,
+                                                 const Points &vertices) {
   std::vector<int> indices;
 
-  for (auto item : items) {
+  for (const auto &item : items) {
     indices.push_back((int)atoi(item.value.c_str()));
   }
 
@@ -2697,8 +6334,326 @@ inline G4bool BuiltInReader::CanRead(Type type) {
   return type == STL || type == OBJ || type == PLY;
 }
 
+inline G4bool BuiltInReader::Stream(G4String filepath, FacetSink &sink) {
+  auto type = TypeFromName(filepath);
+
+  if (type == STL) {
+    return File::STLReader().Stream(filepath, sink);
+  }
+
+  else if (type == OBJ) {
+    return File::OBJReader().Stream(filepath, sink);
+  }
+
+  else if (type == PLY) {
+    return File::PLYReader().Stream(filepath, sink);
+  }
+
+  Exceptions::ReaderCantReadError("BuildInReader::Stream", type, filepath);
+
+  return false;
+}
+
 inline std::shared_ptr<BuiltInReader> BuiltIn() {
   return std::make_shared<BuiltInReader>();
 }
+
+inline G4bool Stream(G4String filepath, FacetSink &sink) {
+  return BuiltIn()->Stream(filepath, sink);
+}
+
+inline G4bool Stream(G4String filepath, FacetCallback callback) {
+  return BuiltIn()->Stream(filepath, callback);
+}
+}
+}
+
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+
+namespace CADMesh {
+
+namespace File {
+
+// Bump when the cache layout changes so that stale files are ignored.
+static const uint32_t CacheVersion = 1;
+static const char CacheMagic[8] = {'C', 'A', 'D', 'M', 'C', 'A', 'C', 'H'};
+
+// 64-bit FNV-1a.
+inline uint64_t HashContents(const char *data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  for (size_t i = 0; i < size; i++) {
+    hash ^= uint8_t(data[i]);
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+inline CachedReader::CachedReader(std::shared_ptr<Reader> reader,
+                                  G4String directory)
+    : Reader("CachedReader"), reader_(reader), directory_(directory) {}
+
+inline G4bool CachedReader::CanRead(Type type) {
+  return reader_->CanRead(type);
+}
+
+inline G4String CachedReader::CachePath(G4String filepath, uint64_t hash) {
+  std::ostringstream path;
+  path << directory_ << "/"
+       << std::filesystem::path(std::string(filepath)).filename().string()
+       << "." << std::hex << hash << ".cmcache";
+
+  return path.str();
+}
+
+inline G4bool CachedReader::Read(G4String filepath) {
+  uint64_t hash = 0;
+  uint64_t size = 0;
+
+  {
+    MappedFile file(filepath);
+
+    if (!file.IsOpen()) {
+      Exceptions::FileNotFound("CachedReader::Read", filepath);
+      return false;
+    }
+
+    hash = HashContents(file.Data(), file.Size());
+    size = file.Size();
+  }
+
+  auto cache_path = CachePath(filepath, hash);
+
+  if (ReadCache(cache_path, hash, size)) {
+    return true;
+  }
+
+  if (!reader_->Read(filepath)) {
+    return false;
+  }
+
+  SetMeshes(reader_->GetMeshes());
+
+  // The cache is only an optimisation, so failing to write it is not fatal.
+  WriteCache(cache_path, hash, size);
+
+  return true;
+}
+
+// The cache holds a header followed by one record per mesh:
+//
+//   char[8] magic, uint32 version, uint32 mesh count,
+//   uint64 source hash, uint64 source size
+//
+//   uint32 name length, name, uint64 vertex count, uint64 triangle count,
+//   uint64[8] validation, double[3 * vertices], uint32[3 * triangles]
+//
+// in native byte order. The version and magic guard against stale or
+// foreign files; any mismatch simply falls back to the source.
+inline G4bool CachedReader::ReadCache(G4String cache_path, uint64_t hash,
+                                      uint64_t size) {
+  MappedFile file(cache_path);
+
+  if (!file.IsOpen()) {
+    return false;
+  }
+
+  const char *position = file.Data();
+  const char *end = file.Data() + file.Size();
+
+  auto take = [&](void *value, size_t bytes) {
+    if (size_t(end - position) < bytes) {
+      return false;
+    }
+
+    std::memcpy(value, position, bytes);
+    position += bytes;
+
+    return true;
+  };
+
+  char magic[8];
+  uint32_t version = 0, mesh_count = 0;
+  uint64_t cached_hash = 0, cached_size = 0;
+
+  if (!take(magic, 8) || std::memcmp(magic, CacheMagic, 8) != 0 ||
+      !take(&version, 4) || version != CacheVersion || !take(&mesh_count, 4) ||
+      !take(&cached_hash, 8) || cached_hash != hash || !take(&cached_size, 8) ||
+      cached_size != size) {
+    return false;
+  }
+
+  Meshes meshes;
+
+  for (uint32_t m = 0; m < mesh_count; m++) {
+    uint32_t name_length = 0;
+    uint64_t vertex_count = 0, triangle_count = 0;
+    uint64_t counts[8];
+
+    if (!take(&name_length, 4) || size_t(end - position) < name_length) {
+      return false;
+    }
+
+    std::string name(position, name_length);
+    position += name_length;
+
+    if (!take(&vertex_count, 8) || !take(&triangle_count, 8) ||
+        !take(counts, sizeof(counts))) {
+      return false;
+    }
+
+    if (uint64_t(end - position) / (3 * sizeof(double)) < vertex_count) {
+      return false;
+    }
+
+    Points points(vertex_count);
+
+    for (auto &point : points) {
+      double xyz[3];
+      take(xyz, sizeof(xyz));
+
+      point.set(xyz[0], xyz[1], xyz[2]);
+    }
+
+    if (uint64_t(end - position) / (3 * sizeof(uint32_t)) < triangle_count) {
+      return false;
+    }
+
+    Triangles triangles;
+    triangles.reserve(triangle_count);
+
+    for (uint64_t t = 0; t < triangle_count; t++) {
+      uint32_t indices[3];
+      take(indices, sizeof(indices));
+
+      if (indices[0] >= vertex_count || indices[1] >= vertex_count ||
+          indices[2] >= vertex_count) {
+        for (auto triangle : triangles) {
+          delete triangle;
+        }
+
+        return false;
+      }
+
+      triangles.push_back(
+          new G4TriangularFacet(points[indices[0]], points[indices[1]],
+                                points[indices[2]], ABSOLUTE));
+    }
+
+    Validation validation;
+    validation.facets = counts[0];
+    validation.vertices = counts[1];
+    validation.edges = counts[2];
+    validation.boundary_edges = counts[3];
+    validation.boundary_components = counts[4];
+    validation.non_manifold_edges = counts[5];
+    validation.flipped_edges = counts[6];
+    validation.degenerate_facets = counts[7];
+
+    auto mesh = Mesh::New(std::move(points), std::move(triangles), name);
+    mesh->SetValidation(validation);
+
+    meshes.push_back(mesh);
+  }
+
+  SetMeshes(meshes);
+
+  return true;
+}
+
+inline G4bool CachedReader::WriteCache(G4String cache_path, uint64_t hash,
+                                       uint64_t size) {
+  std::error_code error;
+  std::filesystem::create_directories(std::string(directory_), error);
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // jobs sharing a cache directory never see a partial file.
+  std::string temporary_path =
+      std::string(cache_path) + ".tmp" +
+      std::to_string(
+          std::chrono::steady_clock::now().time_since_epoch().count());
+
+  std::ofstream file(temporary_path, std::ios::binary);
+
+  if (!file) {
+    return false;
+  }
+
+  auto put = [&](const void *value, size_t bytes) {
+    file.write(static_cast<const char *>(value), bytes);
+  };
+
+  auto meshes = GetMeshes();
+
+  uint32_t mesh_count = meshes.size();
+
+  put(CacheMagic, 8);
+  put(&CacheVersion, 4);
+  put(&mesh_count, 4);
+  put(&hash, 8);
+  put(&size, 8);
+
+  for (auto mesh : meshes) {
+    auto welded = mesh->Weld();
+    auto validation = CADMesh::Validate(welded);
+
+    mesh->SetValidation(validation);
+
+    std::string name = mesh->GetName();
+    uint32_t name_length = name.size();
+    uint64_t vertex_count = welded.vertices.size();
+    uint64_t triangle_count = welded.triangles.size();
+
+    uint64_t counts[8] = {validation.facets,
+                          validation.vertices,
+                          validation.edges,
+                          validation.boundary_edges,
+                          validation.boundary_components,
+                          validation.non_manifold_edges,
+                          validation.flipped_edges,
+                          validation.degenerate_facets};
+
+    put(&name_length, 4);
+    put(name.data(), name_length);
+    put(&vertex_count, 8);
+    put(&triangle_count, 8);
+    put(counts, sizeof(counts));
+
+    for (const auto &vertex : welded.vertices) {
+      double xyz[3] = {vertex.x(), vertex.y(), vertex.z()};
+      put(xyz, sizeof(xyz));
+    }
+
+    for (const auto &triangle : welded.triangles) {
+      uint32_t indices[3] = {uint32_t(triangle[0]), uint32_t(triangle[1]),
+                             uint32_t(triangle[2])};
+      put(indices, sizeof(indices));
+    }
+  }
+
+  file.close();
+
+  if (!file) {
+    std::filesystem::remove(temporary_path, error);
+    return false;
+  }
+
+  std::filesystem::rename(temporary_path, std::string(cache_path), error);
+
+  if (error) {
+    std::filesystem::remove(temporary_path, error);
+    return false;
+  }
+
+  return true;
+}
+
+inline std::shared_ptr<CachedReader> Cached(std::shared_ptr<Reader> reader,
+                                            G4String directory) {
+  return std::make_shared<CachedReader>(reader, directory);
+}
 }
 }
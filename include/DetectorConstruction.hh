@@ -30,27 +30,66 @@
 #define B1DetectorConstruction_h 1
 
 #include "G4VUserDetectorConstruction.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
 
 class G4VPhysicalVolume;
 class G4LogicalVolume;
+class G4GenericMessenger;
 
 namespace B1
 {
 
 /// Detector construction class to define materials and geometry.
+///
+/// The mirror can be built either from CSG solids (a polycone envelope
+/// intersected with a spherical shell) or from a tessellated STL mesh.
+/// The choice is made at run time with the /waterRadiator/mirror/ commands,
+/// followed by /run/reinitializeGeometry if the geometry already exists.
 
 class DetectorConstruction : public G4VUserDetectorConstruction
 {
   public:
-    DetectorConstruction() = default;
-    ~DetectorConstruction() override = default;
+    DetectorConstruction();
+    ~DetectorConstruction() override;
 
     G4VPhysicalVolume* Construct() override;
+    void ConstructSDandField() override;
 
     G4LogicalVolume* GetScoringVolume() const { return fScoringVolume; }
 
+    // Layout of the virtual detector planes. The copy number of each plane
+    // is its index.
+    G4int GetNumberOfPlanes() const { return fNPlanes; }
+    G4double GetPlaneZ(G4int i) const { return fPlaneZ0 + i * fPlaneDeltaZ; }
+    G4double GetPlaneRMin() const { return fPlaneRMin; }
+    G4double GetPlaneRMax() const { return fPlaneRMax; }
+    G4LogicalVolume* GetDetectorVolume() const { return fDetectorLV; }
+
+  private:
+    void DefineCommands();
+
   protected:
     G4LogicalVolume* fScoringVolume = nullptr;
+    G4LogicalVolume* fWindowLV = nullptr;
+    G4LogicalVolume* fDetectorLV = nullptr;
+
+    G4int fNPlanes = 0;
+    G4double fPlaneZ0 = 0.;
+    G4double fPlaneDeltaZ = 0.;
+    G4double fPlaneRMin = 0.;
+    G4double fPlaneRMax = 0.;
+
+  private:
+    G4GenericMessenger* fMessenger = nullptr;
+
+    G4String fMirrorType = "csg";  // "csg" or "stl"
+    G4String fMirrorFile = "Mirror.stl";
+    G4int fMirrorMaxVoxels = -1;  // <= 0 leaves the Geant4 default
+    G4ThreeVector fMirrorVoxelReduction;  // used when fMirrorMaxVoxels <= 0
+    G4String fMirrorCacheDir = "";  // empty disables the mesh cache
+    G4double fMirrorMaxDeviation = 0.;  // decimation tolerance, 0 keeps all facets
+    G4double fMirrorFitTolerance = 0.;  // analytic patch tolerance, 0 stays tessellated
 };
 
 }  // namespace B1
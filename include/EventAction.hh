@@ -51,10 +51,14 @@ class EventAction : public G4UserEventAction
     void EndOfEventAction(const G4Event* event) override;
 
     void AddEdep(G4double edep) { fEdep += edep; }
+    void AddPhoton() { fNPhotons++; }
+    void AddPhotonStep() { fNPhotonSteps++; }
 
   private:
     RunAction* fRunAction = nullptr;
     G4double fEdep = 0.;
+    G4long fNPhotons = 0;  // optical photons tracked in this event
+    G4long fNPhotonSteps = 0;  // and the steps they took
 };
 
 }  // namespace B1
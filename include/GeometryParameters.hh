@@ -0,0 +1,67 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file GeometryParameters.hh
+/// \brief Dimensions of the radiator, beam, mirrors and detector planes
+
+#ifndef B1GeometryParameters_h
+#define B1GeometryParameters_h 1
+
+#include "G4SystemOfUnits.hh"
+#include "globals.hh"
+
+namespace B1
+{
+
+/// The dimensions shared by DetectorConstruction, the photon gun and the
+/// standalone tools, so that they are set in one place.
+
+namespace Geometry
+{
+
+// Cherenkov angle of 8 GeV protons in water
+constexpr G4double cherenkovAngle = 0.713532378;
+
+constexpr G4double beamRadius = 3. * cm;  // radiator and beam pipe
+constexpr G4double beamSigma = 6. * mm;  // beam spot in x and y
+constexpr G4double radiatorLength = 10. * cm;
+
+constexpr G4int nMirrors = 2;  // can only be 2 or 4
+constexpr G4double detectorOffset = 50. * cm;  // radius of the focus, rotates with each mirror
+
+// Virtual detector planes near the focus
+constexpr G4int nPlanes = 24;
+constexpr G4double planeZ0 = -200. * mm;
+constexpr G4double planeDeltaZ = 20. * mm;
+constexpr G4double planeRMin = detectorOffset - 30. * cm;
+constexpr G4double planeRMax = detectorOffset + 30. * cm;
+
+}  // namespace Geometry
+
+}  // namespace B1
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,208 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file HitOutput.hh
+/// \brief Definition of the B1::HitOutput class
+
+#ifndef B1HitOutput_h
+#define B1HitOutput_h 1
+
+#include "PhotonFate.hh"
+#include "PlaneImages.hh"
+
+#include "G4Accumulable.hh"
+#include "G4AnalysisManager.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <array>
+#include <vector>
+
+class G4GenericMessenger;
+
+namespace B1
+{
+
+class DetectorConstruction;
+
+/// An optical photon crossing one of the sensitive surfaces
+
+struct Hit
+{
+  G4int eventID = 0;
+  G4int pdg = 0;
+  G4ThreeVector position;
+  G4ThreeVector momentum;
+  G4double ekin = 0.;
+  G4int plane = -1;  // index of the detector plane, -1 for the window
+};
+
+/// The hits of one event, per hit ntuple
+
+struct EventHits
+{
+  G4int eventID = 0;
+  std::array<std::vector<Hit>, 2> hits;
+  std::array<G4long, 2> seen = {0, 0};  // hits seen in the run up to this event
+  PhotonFate::EventCounts fates = {};  // for the fates ntuple, if booked
+
+  // Empties the buffers, but keeps their memory unless an unusually large
+  // event grew them past maxKeep hits
+  void Clear(std::size_t maxKeep);
+};
+
+/// Books and fills the output ntuples: the two hit ntuples, "windowhits"
+/// and "hits", the "planes" layout, the "prescale" record of how many
+/// hits each hit ntuple kept and the "events" index. With the per-event
+/// photon fates switched on, a "fates" ntuple has their counts, one row
+/// per event.
+///
+/// The hits of an event are written together, so in each file they are one
+/// range of entries per hit ntuple. The events ntuple has a row per event
+/// with hits, giving that range, so an analysis can read any event without
+/// scanning for eventID changes.
+///
+/// Which columns each hit ntuple has, and a pre-scale that keeps 1 in N
+/// hits, are set with the /waterRadiator/output/ commands. The columns are
+/// booked at the start of the first run and fixed after that.
+///
+/// Hits are collected per event and written at the end of it, on the
+/// Geant4 thread that owns the analysis manager.
+///
+/// For long runs the output can be split: after a given number of events,
+/// or of megabytes of hits, the file is written and closed and the next one
+/// opened. Every closed file is complete, with its own layout and prescale
+/// rows, so a run that dies loses only the file it was writing.
+///
+/// The file format (any Geant4 analysis backend: root, hdf5, csv or xml)
+/// and the file name pattern are chosen with the same commands.
+
+class HitOutput
+{
+  public:
+    enum Ntuple { kWindowHits = 0, kPlaneHits = 1, kPlanes = 2, kPrescale = 3,
+                  kEvents = 4, kFates = 5 };
+    enum Column { kEventID, kPDG, kX, kY, kZ, kPx, kPy, kPz, kEkin, kPlane, kNColumns };
+
+    HitOutput();
+    ~HitOutput();
+
+    // Whether to book the fates ntuple; before the first Book()
+    void SetFateColumns(G4bool fateColumns) { if (!fBooked) fFateColumns = fateColumns; }
+    // Books the ntuples and images on the first call and applies the file settings
+    void Book(const DetectorConstruction* detConstruction);
+    // Opens the first file of the run, and writes and closes the last
+    void BeginOfRun(const DetectorConstruction* detConstruction, G4int runID);
+    void EndOfEvent(G4int eventID);
+    void EndOfRun();
+
+    // Counts a hit for the pre-scale; true if it should be written
+    G4bool Accept(G4int ntuple);
+    void Add(G4int ntuple, const Hit& hit) { fEvent.hits[ntuple].push_back(hit); }
+    // Counts a photon in the image of its plane; every photon, not pre-scaled
+    void AddToImage(G4int plane, const G4ThreeVector& position) { fImages.Fill(plane, position); }
+    // The photon fates of the event, for the fates ntuple
+    void SetFates(const PhotonFate::EventCounts& fates) { fEvent.fates = fates; }
+
+  private:
+    void WriteEvent(EventHits& event);
+    void WriteRow(G4int ntuple, const Hit& hit);
+
+    G4String GetFileName() const;
+    void OpenFile();
+    void CloseFile();
+    void NextFile();
+    void WritePlanes();
+    void WritePrescale();
+
+    void DefineCommands();
+    void SetWindowColumns(G4String columns);
+    void SetHitColumns(G4String columns);
+    void SetColumns(G4int ntuple, const G4String& columns);
+    void SetFileType(G4String type);
+
+    // The names of the files the backend writes for fileName on this
+    // thread, to be measured at the end of the run
+    void AddFilePaths(const G4String& fileName);
+    // Adds the size of this thread's files to the run's total
+    void AddFileSizes();
+    // Prints the size of the run's files, once they are all closed
+    void ReportFileSize() const;
+
+    G4GenericMessenger* fMessenger = nullptr;
+    G4bool fBooked = false;
+    G4bool fFateColumns = false;
+    // Does this thread write hits? The workers in MT, or the only thread.
+    // Set in BeginOfRun, on the thread that owns the output.
+    G4bool fWritesHits = false;
+
+    G4String fFileType = "root";
+    // %run is replaced by the run number and %part by the file index;
+    // without %part, files after the first get _<index>
+    G4String fFileName = "output";
+
+    // The analysis manager of the thread that owns this output
+    G4AnalysisManager* fManager = nullptr;
+
+    EventHits fEvent;
+    PlaneImages fImages;
+    G4int fCompression = 1;
+    G4int fBasketSize = 32;  // kB
+
+    // When to start the next file; 0 for never
+    G4int fFlushEvents = 0;
+    G4double fFlushMB = 0.;  // before compression
+
+    const DetectorConstruction* fDetConstruction = nullptr;
+    G4int fRunID = 0;
+    G4int fFile = 0;  // index of the open file in the run
+    G4long fFileEvents = 0;
+    G4double fFileBytes = 0.;
+    std::array<G4int, 2> fRowBytes = {0, 0};
+
+    // Write throughput of the run
+    G4double fRunBytes = 0.;
+    G4double fWriteTime = 0.;  // seconds
+
+    // The files of this thread in the run, and the size on disk of the
+    // files of all threads, merged into the master's
+    std::vector<G4String> fFilePaths;
+    G4Accumulable<G4double> fDiskBytes = 0.;
+    G4Accumulable<G4int> fDiskFiles = 0;
+
+    std::array<std::array<G4bool, kNColumns>, 2> fSelected;
+    std::array<std::array<G4int, kNColumns>, 2> fColumnId;
+
+    std::array<G4int, 2> fPrescale = {1, 1};
+    std::array<G4long, 2> fSeen = {0, 0};  // by the event loop
+    std::array<G4long, 2> fWritten = {0, 0};  // at the end of each event, and the rest below
+    std::array<G4long, 2> fWrittenSeen = {0, 0};  // seen up to the last event written
+    std::array<G4long, 2> fFileSeen = {0, 0};  // counts at the start of the open file
+    std::array<G4long, 2> fFileWritten = {0, 0};
+};
+
+}  // namespace B1
+
+#endif
@@ -0,0 +1,136 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file PhotonFate.hh
+/// \brief Definition of the B1::PhotonFate class
+
+#ifndef B1PhotonFate_h
+#define B1PhotonFate_h 1
+
+#include "G4VAccumulable.hh"
+#include "G4Version.hh"
+#include "globals.hh"
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <tuple>
+
+class G4GenericMessenger;
+class G4LogicalVolume;
+class G4Step;
+
+namespace B1
+{
+
+/// The loss budget of the optical photons: where each was created, how it
+/// ended and what it cost.
+///
+/// Enabled with /waterRadiator/fate/enable true, every optical photon is
+/// counted at the end of its track by the volume it was created in and its
+/// fate: absorbed in a volume (bulk absorption in the water or quartz),
+/// absorbed at the surface of one (the titanium windows, the mirror
+/// reflectivity loss) or escaped from the world. Each tally also has the
+/// photons that reached a detector plane on the way, and their steps and
+/// wall time, charged as in StepProfiler. The tallies are registered with
+/// G4AccumulableManager alongside RunAction's own accumulables, and the
+/// master prints their sum at the end of the run.
+///
+/// /waterRadiator/fate/eventColumns true also writes the counts of each
+/// event, by fate only, to the "fates" ntuple of HitOutput.
+
+class PhotonFate
+{
+  public:
+    enum Fate { kAbsorbedIn, kAbsorbedAt, kEscaped, kNFates };
+    enum EventColumn { kGenerated, kReachedPlanes, kAbsorbedBulk, kAbsorbedSurface,
+                       kEscapedWorld, kSteps, kNEventColumns };
+    using EventCounts = std::array<G4int, kNEventColumns>;
+    static const char* const eventColumnNames[kNEventColumns];
+
+    PhotonFate();
+    ~PhotonFate();
+
+    G4bool IsEnabled() const { return fEnabled || fEventColumns; }
+    G4bool HasEventColumns() const { return fEventColumns; }
+
+    void BeginOfRun(const G4LogicalVolume* detectorVolume);
+    void BeginOfEvent();
+    // Every step, to keep the clock; only optical photons are tallied
+    void Step(const G4Step* step);
+    void EndOfRun();
+
+    const EventCounts& GetEventCounts() const { return fEventCounts; }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+    // Creation volume, fate and the volume of the fate (none for escaped)
+    using Key = std::tuple<const G4LogicalVolume*, G4int, const G4LogicalVolume*>;
+
+    struct Tally
+    {
+      G4long photons = 0;
+      G4long reachedPlanes = 0;
+      G4long steps = 0;
+      Clock::duration time{0};
+    };
+
+    // The tallies of the run by creation volume and fate
+    class Budget : public G4VAccumulable
+    {
+      public:
+        Budget() : G4VAccumulable("photonFates") {}
+
+        void Merge(const G4VAccumulable& other) override;
+        void Reset() override;
+#if G4VERSION_NUMBER >= 1120
+        void Print(G4PrintOptions options = G4PrintOptions()) const override;
+#endif
+
+        std::map<Key, Tally> tallies;
+    };
+
+    void Print() const;
+    void DefineCommands();
+
+    G4GenericMessenger* fMessenger = nullptr;
+    G4bool fEnabled = false;
+    G4bool fEventColumns = false;
+
+    const G4LogicalVolume* fDetectorVolume = nullptr;
+    Budget fBudget;
+    EventCounts fEventCounts = {};
+
+    // The photon being tracked
+    const G4LogicalVolume* fCreation = nullptr;
+    G4bool fReached = false;
+    G4long fSteps = 0;
+    Clock::duration fTime{0};
+    Clock::time_point fLast;
+};
+
+}  // namespace B1
+
+#endif
@@ -0,0 +1,95 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file PlaneImages.hh
+/// \brief Definition of the B1::PlaneImages class
+
+#ifndef B1PlaneImages_h
+#define B1PlaneImages_h 1
+
+#include "G4AnalysisManager.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class G4GenericMessenger;
+
+namespace B1
+{
+
+class DetectorConstruction;
+
+/// Binned x-y images of the photons on each detector plane.
+///
+/// Every photon that reaches a plane is counted, before the pre-scale, in
+/// a plain array owned by the thread. At the end of the run the arrays go
+/// into one H2 per plane, "image<i>", which Geant4 merges over the threads
+/// into the master's file. Spot shapes can then be studied without the
+/// per-photon rows. The binning is set with the /waterRadiator/images/
+/// commands before the first run.
+
+class PlaneImages
+{
+  public:
+    PlaneImages();
+    ~PlaneImages();
+
+    // Books the H2s on the first call
+    void Book(G4AnalysisManager* man, const DetectorConstruction* detConstruction);
+    void BeginOfRun();
+    void EndOfRun(G4AnalysisManager* man);
+
+    // The H2s booked, and the name of each
+    G4int GetNumberOfImages() const { return fImages.size(); }
+    static G4String GetName(G4int plane) { return "image" + std::to_string(plane); }
+
+    void Fill(G4int plane, const G4ThreeVector& position)
+    {
+      if (!fBooked) return;
+      G4double u = (position.x() + fHalfWidth) * fInvBinWidth;
+      G4double v = (position.y() + fHalfWidth) * fInvBinWidth;
+      if (u < 0. || v < 0. || u >= fBins || v >= fBins) return;
+      fImages[plane][G4int(v) * fBins + G4int(u)] += 1.;
+    }
+
+  private:
+    void DefineCommands();
+
+    G4GenericMessenger* fMessenger = nullptr;
+    G4bool fEnabled = true;
+    G4bool fBooked = false;
+
+    G4int fBins = 200;  // per axis
+    G4double fHalfWidth = 0.;  // 0 for the outer radius of the planes
+    G4double fInvBinWidth = 0.;
+
+    G4int fFirstId = -1;  // H2 id of plane 0
+    std::vector<std::vector<G4double>> fImages;  // per plane, fBins x fBins, row by y
+};
+
+}  // namespace B1
+
+#endif
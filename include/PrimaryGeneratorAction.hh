@@ -34,6 +34,7 @@
 class G4ParticleGun;
 class G4Event;
 class G4Box;
+class G4GenericMessenger;
 
 namespace B1
 {
@@ -42,6 +43,11 @@ namespace B1
 ///
 /// The default kinematic is a 6 MeV gamma, randomly distribued
 /// in front of the phantom across 80% of the (X,Y) phantom size.
+///
+/// With /waterRadiator/gun/photons n > 0 each event is instead n optical
+/// photons started along the beam inside the radiator on the Cherenkov
+/// cone, so the optics (window, mirror, planes) can be timed without the
+/// proton shower.
 
 class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
@@ -56,8 +62,15 @@ class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
     const G4ParticleGun* GetParticleGun() const { return fParticleGun; }
 
   private:
+    void GeneratePhotons(G4Event*);
+    void DefineCommands();
+
     G4ParticleGun* fParticleGun = nullptr;  // pointer a to G4 gun class
     G4Box* fEnvelopeBox = nullptr;
+
+    G4GenericMessenger* fMessenger = nullptr;
+    G4int fNPhotons = 0;  // optical photons per event, 0 for the proton beam
+    G4double fPhotonEnergy;
 };
 
 }  // namespace B1
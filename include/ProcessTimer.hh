@@ -0,0 +1,105 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ProcessTimer.hh
+/// \brief Definition of the B1::ProcessTimer and B1::ProcessTimerPhysics classes
+
+#ifndef B1ProcessTimer_h
+#define B1ProcessTimer_h 1
+
+#include "G4VPhysicsConstructor.hh"
+#include "G4WrapperProcess.hh"
+#include "globals.hh"
+
+#include <chrono>
+#include <vector>
+
+namespace B1
+{
+
+/// Wraps a process to count and time its calls.
+///
+/// The post-step interaction length (asked of every process at every
+/// step), the along-step and the post-step DoIt are timed separately. The
+/// wrappers are per thread, like the processes they wrap, and
+/// ProcessTimer::Timers() lists those of the calling thread for
+/// StepProfiler to collect at the end of the run.
+
+class ProcessTimer : public G4WrapperProcess
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Counter
+    {
+      G4long calls = 0;
+      Clock::duration time{0};
+    };
+
+    ProcessTimer(G4VProcess* process);
+    ~ProcessTimer() override;
+
+    G4double PostStepGetPhysicalInteractionLength(const G4Track& track, G4double previousStepSize,
+                                                  G4ForceCondition* condition) override;
+    G4VParticleChange* AlongStepDoIt(const G4Track& track, const G4Step& step) override;
+    G4VParticleChange* PostStepDoIt(const G4Track& track, const G4Step& step) override;
+
+    const G4VProcess* GetWrapped() const { return pRegProcess; }
+    const Counter& GetPostStepGPIL() const { return fPostStepGPIL; }
+    const Counter& GetAlongStepDoIt() const { return fAlongStepDoIt; }
+    const Counter& GetPostStepDoIt() const { return fPostStepDoIt; }
+    void Reset();
+
+    // The wrappers of the calling thread
+    static const std::vector<ProcessTimer*>& Timers();
+
+    // Set with /waterRadiator/profile/processes before /run/initialize
+    static G4bool IsEnabled() { return fEnabled; }
+    static G4bool fEnabled;
+
+  private:
+    Counter fPostStepGPIL;
+    Counter fAlongStepDoIt;
+    Counter fPostStepDoIt;
+};
+
+/// Puts a ProcessTimer around the optical processes: those of the optical
+/// photon (absorption, Rayleigh, Mie, boundary, WLS) and the Cherenkov and
+/// scintillation processes of every particle. Registered last, it does
+/// nothing unless ProcessTimer::IsEnabled().
+
+class ProcessTimerPhysics : public G4VPhysicsConstructor
+{
+  public:
+    ProcessTimerPhysics();
+    ~ProcessTimerPhysics() override = default;
+
+    void ConstructParticle() override {}
+    void ConstructProcess() override;
+};
+
+}  // namespace B1
+
+#endif
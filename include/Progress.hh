@@ -0,0 +1,78 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file Progress.hh
+/// \brief Definition of the B1::Progress class
+
+#ifndef B1Progress_h
+#define B1Progress_h 1
+
+#include "globals.hh"
+
+#include <atomic>
+
+class G4GenericMessenger;
+
+namespace B1
+{
+
+/// Progress of a batch run: events done, events/s in total and per
+/// thread, photons/s and the estimated time left.
+///
+/// Each thread counts its own events; at the end of an event the first
+/// thread to find the report interval (/waterRadiator/progress/interval,
+/// 30 s by default, 0 for off) elapsed prints the progress of all the
+/// threads and rewrites the status file, if one is set with
+/// /waterRadiator/progress/statusFile. The file is a JSON object, written
+/// to a temporary file and renamed over the old one so a monitor polling
+/// it never sees it half written. Between reports an event costs a few
+/// relaxed atomic adds and a clock read.
+
+class Progress
+{
+  public:
+    Progress();
+    ~Progress();
+
+    void BeginOfRun(G4int runID, G4int nEvents);
+    void EndOfEvent(G4long nPhotons);
+    void EndOfRun();
+
+  private:
+    void Report(G4bool done) const;
+    void DefineCommands();
+
+    G4GenericMessenger* fMessenger = nullptr;
+    G4double fInterval;  // between reports, 0 for off
+    G4String fStatusFile;
+
+    G4bool fCounts = false;  // does this thread process events?
+    G4int fThread = 0;
+    std::atomic<G4long> fEvents{0};  // of this thread in the run, read by the reporter
+};
+
+}  // namespace B1
+
+#endif
@@ -32,6 +32,7 @@
 #include "G4UserRunAction.hh"
 
 #include "G4Accumulable.hh"
+#include "G4Timer.hh"
 #include "globals.hh"
 
 class G4Run;
@@ -39,26 +40,50 @@ class G4Run;
 namespace B1
 {
 
+class Benchmark;
+class HitOutput;
+class PhotonFate;
+class Progress;
+class StepProfiler;
+
 /// Run action class
 ///
 /// In EndOfRunAction(), it calculates the dose in the selected volume
 /// from the energy deposit accumulated via stepping and event actions.
-/// The computed dose is then printed on the screen.
+/// The computed dose is then printed on the screen, together with the
+/// number of optical photons tracked, the steps per photon and the photon
+/// throughput, which are used to benchmark the mirror representations.
 
 class RunAction : public G4UserRunAction
 {
   public:
     RunAction();
-    ~RunAction() override = default;
+    ~RunAction() override;
 
     void BeginOfRunAction(const G4Run*) override;
     void EndOfRunAction(const G4Run*) override;
 
     void AddEdep(G4double edep);
+    void AddPhotons(G4long nPhotons, G4long nSteps);
+
+    HitOutput* GetHitOutput() const { return fHitOutput; }
+    StepProfiler* GetStepProfiler() const { return fStepProfiler; }
+    PhotonFate* GetPhotonFate() const { return fPhotonFate; }
+    Progress* GetProgress() const { return fProgress; }
 
   private:
     G4Accumulable<G4double> fEdep = 0.;
     G4Accumulable<G4double> fEdep2 = 0.;
+    G4Accumulable<G4long> fNPhotons = 0;
+    G4Accumulable<G4long> fNPhotonSteps = 0;
+
+    G4Timer fTimer;  // wall time of the run, for the photon throughput
+
+    HitOutput* fHitOutput = nullptr;  // books and fills the ntuples
+    Benchmark* fBenchmark = nullptr;  // JSON performance records, from the master
+    StepProfiler* fStepProfiler = nullptr;  // steps and time per volume and particle
+    PhotonFate* fPhotonFate = nullptr;  // optical photon loss budget
+    Progress* fProgress = nullptr;  // reports during the run
 };
 
 }  // namespace B1
@@ -0,0 +1,161 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file StepProfiler.hh
+/// \brief Definition of the B1::StepProfiler class
+
+#ifndef B1StepProfiler_h
+#define B1StepProfiler_h 1
+
+#include "ProcessTimer.hh"
+
+#include "G4VAccumulable.hh"
+#include "G4Version.hh"
+#include "globals.hh"
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <utility>
+
+class G4GenericMessenger;
+class G4LogicalVolume;
+class G4ParticleDefinition;
+class G4VProcess;
+
+namespace B1
+{
+
+/// Step counts and wall time per logical volume and particle type.
+///
+/// Enabled with /waterRadiator/profile/enable true, it shows where the
+/// steps, optical photons' in particular, and the time of a run go. Each
+/// step is charged the wall time since the previous step of the thread
+/// (or the start of the event), so it includes the tracking overhead
+/// around the step. Each thread keeps its own tallies, an accumulable that
+/// G4AccumulableManager merges into the master's at the end of the run; the
+/// master prints the tables by volume, by particle and, for optical
+/// photons, by volume.
+///
+/// With /waterRadiator/profile/processes true (before /run/initialize) it
+/// also counts the steps limited by each process and collects the calls
+/// and time of the optical processes from their ProcessTimer wrappers.
+/// These are printed too, and written to the benchmark JSON record.
+
+class StepProfiler
+{
+  public:
+    StepProfiler();
+    ~StepProfiler();
+
+    G4bool IsEnabled() const { return fEnabled; }
+    G4bool IsTimingProcesses() const { return ProcessTimer::IsEnabled(); }
+
+    void BeginOfRun();
+    void BeginOfEvent() { fLast = Clock::now(); }
+    void EndOfRun();
+
+    void Step(const G4LogicalVolume* volume, const G4ParticleDefinition* particle)
+    {
+      auto now = Clock::now();
+      Key key(volume, particle);
+      if (!fCurrent || key != fCurrentKey) {
+        fCurrent = &fProfile.steps[key];
+        fCurrentKey = key;
+      }
+      fCurrent->steps++;
+      fCurrent->time += now - fLast;
+      fLast = now;
+    }
+
+    // The process that limited the step
+    void Limited(const G4VProcess* process)
+    {
+      if (process != fLimitedProcess) {
+        fLimitedCount = &fLimited[process];
+        fLimitedProcess = process;
+      }
+      (*fLimitedCount)++;
+    }
+
+    // The process tallies of the last run, as a JSON object
+    void WriteProcessesJSON(std::ostream& out) const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+    using Key = std::pair<const G4LogicalVolume*, const G4ParticleDefinition*>;
+
+    struct Tally
+    {
+      G4long steps = 0;
+      Clock::duration time{0};
+    };
+
+    // By process name, to merge over the threads
+    struct ProcessTally
+    {
+      G4long limited = 0;
+      ProcessTimer::Counter postStepGPIL, alongStepDoIt, postStepDoIt;
+    };
+    using ProcessTallies = std::map<G4String, ProcessTally>;
+
+    // The tallies of the run, by volume and particle and by process
+    class Profile : public G4VAccumulable
+    {
+      public:
+        Profile() : G4VAccumulable("stepProfile") {}
+
+        void Merge(const G4VAccumulable& other) override;
+        void Reset() override;
+#if G4VERSION_NUMBER >= 1120
+        void Print(G4PrintOptions options = G4PrintOptions()) const override;
+#endif
+
+        std::map<Key, Tally> steps;
+        ProcessTallies processes;
+    };
+
+    ProcessTallies CollectProcesses() const;
+    static void AddProcesses(ProcessTallies& to, const ProcessTallies& from);
+    void Print() const;
+    void PrintProcesses() const;
+    void DefineCommands();
+
+    G4GenericMessenger* fMessenger = nullptr;
+    G4bool fEnabled = false;
+
+    Profile fProfile;
+    Tally* fCurrent = nullptr;  // tally of the last step, usually the next one's too
+    Key fCurrentKey;
+    Clock::time_point fLast;
+
+    std::map<const G4VProcess*, G4long> fLimited;
+    const G4VProcess* fLimitedProcess = nullptr;
+    G4long* fLimitedCount = nullptr;
+};
+
+}  // namespace B1
+
+#endif
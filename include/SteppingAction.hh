@@ -38,13 +38,15 @@ namespace B1
 {
 
 class EventAction;
+class PhotonFate;
+class StepProfiler;
 
 /// Stepping action class
 
 class SteppingAction : public G4UserSteppingAction
 {
   public:
-    SteppingAction(EventAction* eventAction);
+    SteppingAction(EventAction* eventAction, StepProfiler* profiler, PhotonFate* fate);
     ~SteppingAction() override = default;
 
     // method from the base class
@@ -52,6 +54,8 @@ class SteppingAction : public G4UserSteppingAction
 
   private:
     EventAction* fEventAction = nullptr;
+    StepProfiler* fProfiler = nullptr;
+    PhotonFate* fFate = nullptr;
     G4LogicalVolume* fScoringVolume = nullptr;
 };
 
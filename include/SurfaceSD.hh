@@ -4,10 +4,39 @@
 #include "G4VSensitiveDetector.hh"
 #include "G4Step.hh"
 
+namespace B1 { class HitOutput; }
+
+// Base for the sensitive surfaces. Each kind of volume gets its own
+// detector, so a hit already knows where it is and which ntuple it goes to.
 class SurfaceSD : public G4VSensitiveDetector {
 public:
-  SurfaceSD(const G4String& name);
+  SurfaceSD(const G4String& name, G4int ntupleId);
   virtual ~SurfaceSD() = default;
 
+protected:
+  // Passes the hit to the run action's HitOutput, which applies the
+  // pre-scale and queues it for the end of the event. plane is -1 for the window.
+  void RecordHit(G4Step* step, G4int plane);
+
+  G4int fNtupleId;
+
+private:
+  B1::HitOutput* fOutput = nullptr;
+};
+
+// The quartz exit window. Fills "windowhits" with forward going photons.
+class WindowSD : public SurfaceSD {
+public:
+  WindowSD(const G4String& name);
+
+  virtual G4bool ProcessHits(G4Step* step, G4TouchableHistory*) override;
+};
+
+// The virtual detector planes. Fills "hits" with the copy number of the
+// plane, which DetectorConstruction sets to the plane index.
+class PlaneSD : public SurfaceSD {
+public:
+  PlaneSD(const G4String& name);
+
   virtual G4bool ProcessHits(G4Step* step, G4TouchableHistory*) override;
 };
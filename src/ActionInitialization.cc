@@ -56,7 +56,8 @@ void ActionInitialization::Build() const
   auto eventAction = new EventAction(runAction);
   SetUserAction(eventAction);
 
-  SetUserAction(new SteppingAction(eventAction));
+  SetUserAction(
+    new SteppingAction(eventAction, runAction->GetStepProfiler(), runAction->GetPhotonFate()));
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,138 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file Benchmark.cc
+/// \brief Implementation of the B1::Benchmark class
+
+#include "Benchmark.hh"
+
+#include "StepProfiler.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4RunManager.hh"
+
+#include <chrono>
+#include <fstream>
+#include <sys/resource.h>
+
+namespace B1
+{
+
+namespace
+{
+// Close enough to the start of the program: static initialization
+const auto programStart = std::chrono::steady_clock::now();
+
+G4double PeakRSS()
+{
+  // ru_maxrss is in kB on Linux and in bytes on macOS
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.;
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024. * 1024.);
+#else
+  return usage.ru_maxrss / 1024.;
+#endif
+}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Benchmark::Benchmark()
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Benchmark::~Benchmark()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Benchmark::BeginOfRun()
+{
+  if (fStartup < 0.) {
+    fStartup =
+      std::chrono::duration<G4double>(std::chrono::steady_clock::now() - programStart).count();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Benchmark::EndOfRun(G4int nEvents, G4long nPhotons, G4long nPhotonSteps, G4double realTime,
+                         const StepProfiler& profiler)
+{
+  if (fFileName.empty()) return;
+
+  std::ofstream out(fFileName, std::ios::app);
+  if (!out) {
+    G4ExceptionDescription msg;
+    msg << "Can't write the benchmark results to " << fFileName << ".";
+    G4Exception("Benchmark::EndOfRun()", "MyCode0005", JustWarning, msg);
+    return;
+  }
+
+  G4double seconds = realTime > 0. ? realTime : 1e-9;
+  out << "{\"label\": \"" << fLabel << "\""
+      << ", \"threads\": " << G4RunManager::GetRunManager()->GetNumberOfThreads()
+      << ", \"events\": " << nEvents
+      << ", \"seconds\": " << realTime
+      << ", \"eventsPerSecond\": " << nEvents / seconds
+      << ", \"photons\": " << nPhotons
+      << ", \"photonsPerSecond\": " << nPhotons / seconds
+      << ", \"stepsPerPhoton\": " << (nPhotons > 0 ? G4double(nPhotonSteps) / nPhotons : 0.)
+      << ", \"peakRSSMB\": " << PeakRSS()
+      << ", \"startupSeconds\": " << fStartup;
+  if (profiler.IsTimingProcesses()) {
+    out << ", \"processes\": ";
+    profiler.WriteProcessesJSON(out);
+  }
+  out << "}" << std::endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Benchmark::DefineCommands()
+{
+  // Define /waterRadiator/benchmark command directory using generic messenger class
+  fMessenger = new G4GenericMessenger(this, "/waterRadiator/benchmark/", "Benchmark results");
+
+  auto& jsonCmd = fMessenger->DeclareProperty("json", fFileName,
+    "Append the performance of each run to this file, one JSON object per line (empty: off).");
+  jsonCmd.SetParameterName("file", true);
+  jsonCmd.SetDefaultValue("");
+
+  auto& labelCmd = fMessenger->DeclareProperty("label", fLabel,
+    "Name of the workload, written with each record.");
+  labelCmd.SetParameterName("label", true);
+  labelCmd.SetDefaultValue("run");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}  // namespace B1
@@ -27,6 +27,7 @@
 /// \brief Implementation of the B1::DetectorConstruction class
 
 #include "DetectorConstruction.hh"
+#include "GeometryParameters.hh"
 
 #include "G4Box.hh"
 #include "G4LogicalVolume.hh"
@@ -40,12 +41,15 @@
 #include "G4Tubs.hh"
 #include "G4Sphere.hh"
 #include "G4IntersectionSolid.hh"
+#include "G4MultiUnion.hh"
+#include "G4TessellatedSolid.hh"
 #include "G4UnionSolid.hh"
 #include "G4RotationMatrix.hh"
 #include "G4ios.hh"
 
 #include "G4OpticalSurface.hh"
 #include "G4LogicalSkinSurface.hh"
+#include "G4GenericMessenger.hh"
 
 // Stuff for the sensitive surface
 #include "G4SDManager.hh"
@@ -62,6 +66,20 @@ namespace B1
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+DetectorConstruction::DetectorConstruction()
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+DetectorConstruction::~DetectorConstruction()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 G4VPhysicalVolume* DetectorConstruction::Construct()
 {
    // Set up some basic parameters
@@ -72,16 +90,16 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
    G4double world_sizeZ = 2400. * mm;
   
     // Make the shapes for the radiator and transport sections
-   G4double ang=0.713532378;   // Cherenkov angle
+   G4double ang = Geometry::cherenkovAngle;
 
-   G4double beamRadius = 3.*cm;
-   G4double lenRadiator = 10.*cm;
+   G4double beamRadius = Geometry::beamRadius;
+   G4double lenRadiator = Geometry::radiatorLength;
    G4double beamWindowThickness = .1*mm;
    G4double windowThickness = 1*mm;   // quartz window
-   G4int  nMirrors = 2;   // Number of mirrors (can only be 2 or 4)
+   G4int  nMirrors = Geometry::nMirrors;   // Number of mirrors (can only be 2 or 4)
    G4double mirrorRadius = 50.*cm;
    G4double mirrorThickness = 2.*mm;
-   G4double yDetector = 50*cm; // Offset to detector.  It will rotate for each mirror
+   G4double yDetector = Geometry::detectorOffset; // Offset to detector.  It will rotate for each mirror
    // Build the materials 
    // This builds the radiator Solid
    static MyMaterials mat;
@@ -125,12 +143,8 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
 
 
 
-   //Make the window a sensitive detector
-   auto sdManager = G4SDManager::GetSDMpointer();
-   auto surfaceSD = new SurfaceSD("Window");
-   sdManager->AddNewDetector(surfaceSD);
-
-   rad.windowLV->SetSensitiveDetector(surfaceSD);
+   // The window is a sensitive detector, attached in ConstructSDandField
+   fWindowLV = rad.windowLV;
 
    // Plase the combined radiator/window into the world.
    G4ThreeVector pos(0.,0.,0);
@@ -187,61 +201,128 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
     );
 
   
-    // Uncomment the code below to read in the mirror from an STL file
-    // Import the .stl file
-    /*
-    auto mesh = CADMesh::TessellatedMesh::FromSTL("Mirror.stl");
-    mesh->SetScale(1.0);  // mm
-
-     G4VSolid* reflectorSolid = mesh->GetSolid();
-    */
-    // Otherwise, build the mirror by intersecting a partial sphere with a polycone
-    // Origin or the center of the photons that get through
-    //  Playing with different values
-    G4double zOrigin = (lenRadiator-beamRadius/tan(ang))/2.;
-    zOrigin = 0;
+    // The mirror is either read in from an STL file or built from CSG solids,
+    // depending on /waterRadiator/mirror/type
+    G4VSolid* reflectorSolid = nullptr;
+
+    if (fMirrorType == "stl") {
+      // Import the .stl file
+      // With a cache directory the parsed mesh is stored on the first run
+      // and mapped back in on later runs of the same file
+      auto reader = CADMesh::File::CADMESH_DEFAULT_READER();
+      auto mesh = fMirrorCacheDir.empty()
+        ? CADMesh::TessellatedMesh::FromSTL(fMirrorFile, reader)
+        : CADMesh::TessellatedMesh::FromSTL(fMirrorFile, CADMesh::File::Cached(reader, fMirrorCacheDir));
+      mesh->SetScale(1.0);  // mm
+      mesh->SetMaxVoxels(fMirrorMaxVoxels);
+      mesh->SetVoxelReductionRatio(fMirrorVoxelReduction);
+
+      // Decimate here rather than in GetTessellatedSolid, so that the mesh
+      // checked below is the one the navigator gets
+      auto fileMesh = mesh->GetMesh();
+      auto solidMesh = fileMesh;
+      if (fMirrorMaxDeviation > 0.) {
+        solidMesh = fileMesh->Decimate(fMirrorMaxDeviation / mesh->GetScale());
+        G4cout << "Decimated mirror mesh " << fMirrorFile << " from "
+               << fileMesh->GetTriangles().size() << " to "
+               << solidMesh->GetTriangles().size() << " facets" << G4endl;
+      }
+
+      // Check the mesh is closed before handing it to the navigator
+      auto validation = solidMesh->Validate();
+      G4cout << "Mirror mesh " << fMirrorFile << ": " << validation << G4endl;
+      if (!validation.IsValidForNavigation()) {
+        G4ExceptionDescription msg;
+        msg << "Mirror mesh " << fMirrorFile << " is not closed and manifold.\n";
+        msg << "Photons may leak through or get stuck on the reflector.";
+        G4Exception("DetectorConstruction::Construct()", "MyCode0003", JustWarning, msg);
+      }
+
+      if (fMirrorFitTolerance > 0.) {
+        // Replace the parts of the mesh that follow planes, spheres or tori,
+        // and the swept segments of Mirror.stl, with CSG solids; the rest
+        // stays tessellated, decimated on its own
+        CADMesh::Patches patches;
+        mesh->SetMaxDeviation(fMirrorMaxDeviation);
+        reflectorSolid = mesh->GetAnalyticSolid(fMirrorFitTolerance, &patches);
+
+        G4int parts = 1;
+        G4int tessellatedParts = dynamic_cast<G4TessellatedSolid*>(reflectorSolid) ? 1 : 0;
+        if (auto compound = dynamic_cast<G4MultiUnion*>(reflectorSolid)) {
+          parts = compound->GetNumberOfSolids();
+          tessellatedParts = 0;
+          for (G4int i = 0; i < parts; i++) {
+            if (dynamic_cast<G4TessellatedSolid*>(compound->GetSolid(i))) tessellatedParts++;
+          }
+        }
+        G4cout << "Built mirror from " << fMirrorFile << " as a "
+               << reflectorSolid->GetEntityType() << " of " << parts << " solids, "
+               << tessellatedParts << " of them tessellated; the mesh has "
+               << patches.size() << " analytic patches" << G4endl;
+
+        if (fMirrorMaxDeviation > 0. && tessellatedParts == 0) {
+          G4ExceptionDescription msg;
+          msg << "The whole mirror was replaced with CSG solids, so\n";
+          msg << "/waterRadiator/mirror/maxDeviation has nothing left to decimate.";
+          G4Exception("DetectorConstruction::Construct()", "MyCode0006", JustWarning, msg);
+        }
+      }
+      else {
+        auto tessellatedSolid = mesh->GetTessellatedSolid(solidMesh);
+        reflectorSolid = tessellatedSolid;
+        G4cout << "Built tessellated mirror from " << fMirrorFile << " with "
+               << tessellatedSolid->GetNumberOfFacets() << " facets" << G4endl;
+      }
+    }
+    else {
+      // Otherwise, build the mirror by intersecting a partial sphere with a polycone
+      // Origin or the center of the photons that get through
+      //  Playing with different values
+      G4double zOrigin = (lenRadiator-beamRadius/tan(ang))/2.;
+      zOrigin = 0;
   
-    // Construct a polycone that will be the envelope for  the mirror by projecting
-    // the exit window
-    G4double zEnv[2] = {lenRadiator,zOrigin+mirrorRadius+mirrorThickness};
-    G4double rEnvInner[2] = {beamRadius-1*cm,beamRadius-1.*cm+(zEnv[1]-zEnv[0])*tan(ang)};
-    G4double rEnvOuter[2] = {beamRadius+1*cm+lenRadiator*tan(ang),beamRadius+1.*cm+
-         zEnv[1]*tan(ang)};
+      // Construct a polycone that will be the envelope for  the mirror by projecting
+      // the exit window
+      G4double zEnv[2] = {lenRadiator,zOrigin+mirrorRadius+mirrorThickness};
+      G4double rEnvInner[2] = {beamRadius-1*cm,beamRadius-1.*cm+(zEnv[1]-zEnv[0])*tan(ang)};
+      G4double rEnvOuter[2] = {beamRadius+1*cm+lenRadiator*tan(ang),beamRadius+1.*cm+
+           zEnv[1]*tan(ang)};
          
-    // Determine the extent of the envelope based on the number of mirrors
-    G4double envPhi0=1.*deg;
-    G4double envDeltaPhi=178*deg;
-    if(nMirrors==4) {
-      envPhi0=46.*deg;
-      envDeltaPhi=88.*deg;
-    }
+      // Determine the extent of the envelope based on the number of mirrors
+      G4double envPhi0=1.*deg;
+      G4double envDeltaPhi=178*deg;
+      if(nMirrors==4) {
+        envPhi0=46.*deg;
+        envDeltaPhi=88.*deg;
+      }
   
-    auto envelope = new G4Polycone("Envelope",
-         envPhi0,
-         envDeltaPhi,
-         2,
-         zEnv,
-         rEnvInner,
-         rEnvOuter);
+      auto envelope = new G4Polycone("Envelope",
+           envPhi0,
+           envDeltaPhi,
+           2,
+           zEnv,
+           rEnvInner,
+           rEnvOuter);
          
-    // Now create the section of the spherical mirror
+      // Now create the section of the spherical mirror
   
   
-    auto sphere = new G4Sphere("Reflector",
-                           mirrorRadius,
-                           mirrorRadius+mirrorThickness,
-                           0.*deg, 360.*degree,
-                           0.*deg, 60.*degree);
+      auto sphere = new G4Sphere("Reflector",
+                             mirrorRadius,
+                             mirrorRadius+mirrorThickness,
+                             0.*deg, 360.*degree,
+                             0.*deg, 60.*degree);
                            
-    // Now make the mirror from the union of the two.  Make the origine of the rays the 
-    // middle of the part of the radiator that makes it out
-    auto reflectorSolid = new G4IntersectionSolid(
-       "Mirror",
-       envelope,
-       sphere,
-       nullptr,      // <-- no rotation
-       G4ThreeVector(0.,yDetector/2.,zOrigin)     // <-- translation only
-    );
+      // Now make the mirror from the union of the two.  Make the origine of the rays the 
+      // middle of the part of the radiator that makes it out
+      reflectorSolid = new G4IntersectionSolid(
+         "Mirror",
+         envelope,
+         sphere,
+         nullptr,      // <-- no rotation
+         G4ThreeVector(0.,yDetector/2.,zOrigin)     // <-- translation only
+      );
+    }
     
     auto reflectorLV = new G4LogicalVolume (
       reflectorSolid,
@@ -277,11 +358,19 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
         false                     // check overlaps
       );
      }
-    // Set up a bunch of virtual detectors near the focal plane
+    // Set up a bunch of virtual detectors near the focal plane. The layout
+    // is written to the output by RunAction, so the analysis doesn't need
+    // to repeat it.
+    fNPlanes = Geometry::nPlanes;
+    fPlaneZ0 = Geometry::planeZ0;
+    fPlaneDeltaZ = Geometry::planeDeltaZ;
+    fPlaneRMin = Geometry::planeRMin;
+    fPlaneRMax = Geometry::planeRMax;
+
     auto detectorTube = new G4Tubs(
       "Detector",
-      yDetector-30.*cm,
-      yDetector+30.*cm,
+      fPlaneRMin,
+      fPlaneRMax,
       1*mm,
       0*degree,
       360*degree);
@@ -293,17 +382,12 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
     );
     
 
-    detectorLV->SetSensitiveDetector(surfaceSD);
+    fDetectorLV = detectorLV;
 
-    // The values RMSStudy should match these (yeah, I know I should put it in
-    // a header file.)    
-    const G4int NDET=24;
-    G4double z0=-200*mm,deltaZ=20.*mm;
-    
-    for(int i=0;i<NDET;i++) {
+    for(int i=0;i<fNPlanes;i++) {
           new G4PVPlacement(
           nullptr,                 // no rotation
-          G4ThreeVector(0,0,z0+i*deltaZ),    // position
+          G4ThreeVector(0,0,GetPlaneZ(i)),    // position
           detectorLV,           // logical volume
           "Detector",          // name
           logicWorld,              // mother volume
@@ -324,4 +408,75 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void DetectorConstruction::ConstructSDandField()
+{
+  // The window and the planes each have their own detector, so a hit does
+  // not have to look up which volume it is in. Reuse them if the geometry is
+  // being rebuilt (eg, after changing the mirror type)
+  auto sdManager = G4SDManager::GetSDMpointer();
+
+  auto windowSD = sdManager->FindSensitiveDetector("Window", false);
+  if (!windowSD) {
+    windowSD = new WindowSD("Window");
+    sdManager->AddNewDetector(windowSD);
+  }
+  SetSensitiveDetector(fWindowLV, windowSD);
+
+  auto planeSD = sdManager->FindSensitiveDetector("Planes", false);
+  if (!planeSD) {
+    planeSD = new PlaneSD("Planes");
+    sdManager->AddNewDetector(planeSD);
+  }
+  SetSensitiveDetector(fDetectorLV, planeSD);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::DefineCommands()
+{
+  // Define /waterRadiator/mirror command directory using generic messenger class
+  fMessenger = new G4GenericMessenger(this, "/waterRadiator/mirror/", "Mirror control");
+
+  auto& typeCmd = fMessenger->DeclareProperty("type", fMirrorType,
+    "Mirror representation: csg (polycone x sphere) or stl (tessellated mesh).");
+  typeCmd.SetParameterName("type", true);
+  typeCmd.SetCandidates("csg stl");
+  typeCmd.SetDefaultValue("csg");
+
+  auto& fileCmd = fMessenger->DeclareProperty("file", fMirrorFile,
+    "STL file used when the mirror type is stl.");
+  fileCmd.SetParameterName("file", true);
+  fileCmd.SetDefaultValue("Mirror.stl");
+
+  auto& voxelCmd = fMessenger->DeclareProperty("maxVoxels", fMirrorMaxVoxels,
+    "Maximum number of voxels for the tessellated mirror (<=0: Geant4 default).");
+  voxelCmd.SetParameterName("maxVoxels", true);
+  voxelCmd.SetDefaultValue("-1");
+
+  auto& reductionCmd = fMessenger->DeclareProperty("voxelReduction", fMirrorVoxelReduction,
+    "Voxel reduction ratio per axis for the tessellated mirror, used if maxVoxels <= 0.");
+  reductionCmd.SetParameterName("rx", "ry", "rz", true);
+
+  auto& cacheCmd = fMessenger->DeclareProperty("cacheDir", fMirrorCacheDir,
+    "Directory for the binary mesh cache of the STL mirror (empty: no cache).");
+  cacheCmd.SetParameterName("cacheDir", true);
+  cacheCmd.SetDefaultValue("");
+
+  auto& deviationCmd = fMessenger->DeclarePropertyWithUnit("maxDeviation", "mm", fMirrorMaxDeviation,
+    "Decimate the tessellated mirror, moving its surface by at most this much (0: keep all facets).\n"
+    "With fitTolerance, only the parts left tessellated are decimated.");
+  deviationCmd.SetParameterName("maxDeviation", true);
+  deviationCmd.SetRange("maxDeviation>=0.");
+  deviationCmd.SetDefaultValue("0.");
+
+  auto& fitCmd = fMessenger->DeclarePropertyWithUnit("fitTolerance", "mm", fMirrorFitTolerance,
+    "Replace planar slabs, spherical or toroidal shells and swept segments in the mirror mesh\n"
+    "with CSG solids, fitting the surfaces to this tolerance (0: keep the tessellated solid).");
+  fitCmd.SetParameterName("fitTolerance", true);
+  fitCmd.SetRange("fitTolerance>=0.");
+  fitCmd.SetDefaultValue("0.");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 }  // namespace B1
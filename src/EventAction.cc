@@ -28,7 +28,13 @@
 
 #include "EventAction.hh"
 
+#include "HitOutput.hh"
+#include "PhotonFate.hh"
+#include "Progress.hh"
 #include "RunAction.hh"
+#include "StepProfiler.hh"
+
+#include "G4Event.hh"
 
 namespace B1
 {
@@ -42,14 +48,30 @@ EventAction::EventAction(RunAction* runAction) : fRunAction(runAction) {}
 void EventAction::BeginOfEventAction(const G4Event*)
 {
   fEdep = 0.;
+  fNPhotons = 0;
+  fNPhotonSteps = 0;
+
+  auto profiler = fRunAction->GetStepProfiler();
+  if (profiler->IsEnabled()) profiler->BeginOfEvent();
+  auto fate = fRunAction->GetPhotonFate();
+  if (fate->IsEnabled()) fate->BeginOfEvent();
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void EventAction::EndOfEventAction(const G4Event*)
+void EventAction::EndOfEventAction(const G4Event* event)
 {
   // accumulate statistics in run action
   fRunAction->AddEdep(fEdep);
+  fRunAction->AddPhotons(fNPhotons, fNPhotonSteps);
+
+  // hand the hits of the event to the output
+  auto output = fRunAction->GetHitOutput();
+  auto fate = fRunAction->GetPhotonFate();
+  if (fate->HasEventColumns()) output->SetFates(fate->GetEventCounts());
+  output->EndOfEvent(event->GetEventID());
+
+  fRunAction->GetProgress()->EndOfEvent(fNPhotons);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,594 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file HitOutput.cc
+/// \brief Implementation of the B1::HitOutput class
+
+#include "HitOutput.hh"
+
+#include "DetectorConstruction.hh"
+
+#include "G4AccumulableManager.hh"
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "G4Tokenizer.hh"
+
+#include <chrono>
+#include <filesystem>
+
+namespace B1
+{
+
+namespace
+{
+// Column names in booking order
+const char* columnNames[HitOutput::kNColumns] = {
+  "eventID", "pdg", "x", "y", "z", "px", "py", "pz", "ekin", "plane"};
+
+const char* ntupleNames[2] = {"windowhits", "hits"};
+const char* ntupleTitles[2] = {"Particles exiting window", "Particles crossing virtual detector"};
+
+// Hits an event buffer keeps room for between events
+const std::size_t maxKeptHits = 8192;
+
+// The rest are doubles
+G4bool IsIntColumn(G4int column)
+{
+  return column == HitOutput::kEventID || column == HitOutput::kPDG || column == HitOutput::kPlane;
+}
+
+
+G4String Replace(G4String text, const G4String& token, const G4String& value)
+{
+  for (auto i = text.find(token); i != G4String::npos; i = text.find(token, i + value.size())) {
+    text.replace(i, token.size(), value);
+  }
+  return text;
+}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void EventHits::Clear(std::size_t maxKeep)
+{
+  for (auto& buffer : hits) {
+    if (buffer.capacity() > maxKeep) {
+      std::vector<Hit>().swap(buffer);
+    }
+    else {
+      buffer.clear();
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+HitOutput::HitOutput()
+{
+  // Everything by default; the window has no plane
+  for (auto& selected : fSelected) selected.fill(true);
+  fSelected[kWindowHits][kPlane] = false;
+
+  for (auto& ids : fColumnId) ids.fill(-1);
+
+  auto accumulableManager = G4AccumulableManager::Instance();
+  accumulableManager->Register(fDiskBytes);
+  accumulableManager->Register(fDiskFiles);
+
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+HitOutput::~HitOutput()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::Book(const DetectorConstruction* detConstruction)
+{
+  fManager = G4AnalysisManager::Instance();
+  fManager->SetCompressionLevel(fCompression);
+  fManager->SetBasketSize(fBasketSize * 1024);
+
+  if (fBooked) return;
+  fBooked = true;
+
+  auto man = fManager;
+
+  // The ntuples are created for this backend, so it is fixed from now on.
+  // File names are given without an extension and Geant4 adds the right one.
+  man->SetDefaultFileType(fFileType);
+
+  for (G4int ntuple : {kWindowHits, kPlaneHits}) {
+    man->CreateNtuple(ntupleNames[ntuple], ntupleTitles[ntuple]);
+    for (G4int column = 0; column < kNColumns; column++) {
+      if (!fSelected[ntuple][column]) continue;
+      if (IsIntColumn(column)) {
+        fColumnId[ntuple][column] = man->CreateNtupleIColumn(columnNames[column]);
+        fRowBytes[ntuple] += sizeof(G4int);
+      }
+      else {
+        fColumnId[ntuple][column] = man->CreateNtupleDColumn(columnNames[column]);
+        fRowBytes[ntuple] += sizeof(G4double);
+      }
+    }
+    man->FinishNtuple();
+  }
+
+  // Layout of the detector planes, one row per plane
+  man->CreateNtuple("planes", "Virtual detector plane layout");
+  man->CreateNtupleIColumn("plane");
+  man->CreateNtupleDColumn("z");
+  man->CreateNtupleDColumn("rMin");
+  man->CreateNtupleDColumn("rMax");
+  man->FinishNtuple();
+
+  // Hits seen and written per hit ntuple; fraction = written/seen
+  man->CreateNtuple("prescale", "Fraction of hits written");
+  man->CreateNtupleSColumn("ntuple");
+  man->CreateNtupleIColumn("prescale");
+  man->CreateNtupleDColumn("seen");
+  man->CreateNtupleDColumn("written");
+  man->CreateNtupleDColumn("fraction");
+  man->FinishNtuple();
+
+  // Index of the events in this file: the first entry and the number of
+  // entries of each in windowhits and hits
+  man->CreateNtuple("events", "Entry ranges of each event");
+  man->CreateNtupleIColumn("eventID");
+  man->CreateNtupleIColumn("windowFirst");
+  man->CreateNtupleIColumn("windowCount");
+  man->CreateNtupleIColumn("hitFirst");
+  man->CreateNtupleIColumn("hitCount");
+  man->FinishNtuple();
+
+  // Photon counts of every event by fate, and their steps
+  if (fFateColumns) {
+    man->CreateNtuple("fates", "Optical photon fates per event");
+    man->CreateNtupleIColumn("eventID");
+    for (auto name : PhotonFate::eventColumnNames) man->CreateNtupleIColumn(name);
+    man->FinishNtuple();
+  }
+
+  fImages.Book(man, detConstruction);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::BeginOfRun(const DetectorConstruction* detConstruction, G4int runID)
+{
+  fDetConstruction = detConstruction;
+  fRunID = runID;
+  fRunBytes = 0.;
+  fWriteTime = 0.;
+  fSeen = {0, 0};
+  fWritten = {0, 0};
+  fWrittenSeen = {0, 0};
+  fFile = 0;
+  fFilePaths.clear();
+  fWritesHits = G4Threading::IsWorkerThread() || !G4Threading::IsMultithreadedApplication();
+  fImages.BeginOfRun();
+
+  OpenFile();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::EndOfEvent(G4int eventID)
+{
+  fEvent.eventID = eventID;
+  fEvent.seen = fSeen;
+
+  WriteEvent(fEvent);
+  fEvent.Clear(maxKeptHits);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::EndOfRun()
+{
+  // Into the last file; Geant4 merges the images of the threads
+  if (fWritesHits) fImages.EndOfRun(fManager);
+
+  auto start = std::chrono::steady_clock::now();
+  CloseFile();
+  fWriteTime += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+
+  if (fWritesHits) {
+    G4double MB = fRunBytes / (1024. * 1024.);
+    G4cout << " Hit output (" << fFileType << "): " << fWritten[kWindowHits] + fWritten[kPlaneHits]
+           << " rows, " << MB << " MB before compression in " << fFile + 1 << " file(s); "
+           << fWriteTime << " s writing";
+    if (fWriteTime > 0.) G4cout << " (" << MB / fWriteTime << " MB/s)";
+    G4cout << G4endl;
+  }
+
+  AddFileSizes();
+
+  // The master ends the run after the workers, when all files are closed
+  // and their sizes merged
+  if (!G4Threading::IsWorkerThread()) ReportFileSize();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool HitOutput::Accept(G4int ntuple)
+{
+  return fSeen[ntuple]++ % fPrescale[ntuple] == 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::WriteEvent(EventHits& event)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  std::array<G4long, 2> first;
+  for (G4int ntuple : {kWindowHits, kPlaneHits}) {
+    first[ntuple] = fWritten[ntuple] - fFileWritten[ntuple];
+    for (const auto& hit : event.hits[ntuple]) WriteRow(ntuple, hit);
+  }
+
+  if (!event.hits[kWindowHits].empty() || !event.hits[kPlaneHits].empty()) {
+    auto man = fManager;
+    man->FillNtupleIColumn(kEvents, 0, event.eventID);
+    man->FillNtupleIColumn(kEvents, 1, first[kWindowHits]);
+    man->FillNtupleIColumn(kEvents, 2, event.hits[kWindowHits].size());
+    man->FillNtupleIColumn(kEvents, 3, first[kPlaneHits]);
+    man->FillNtupleIColumn(kEvents, 4, event.hits[kPlaneHits].size());
+    man->AddNtupleRow(kEvents);
+    fFileBytes += 5 * sizeof(G4int);
+    fRunBytes += 5 * sizeof(G4int);
+  }
+
+  if (fFateColumns) {
+    auto man = fManager;
+    man->FillNtupleIColumn(kFates, 0, event.eventID);
+    for (G4int i = 0; i < PhotonFate::kNEventColumns; i++) {
+      man->FillNtupleIColumn(kFates, i + 1, event.fates[i]);
+    }
+    man->AddNtupleRow(kFates);
+    fFileBytes += (PhotonFate::kNEventColumns + 1) * sizeof(G4int);
+    fRunBytes += (PhotonFate::kNEventColumns + 1) * sizeof(G4int);
+  }
+
+  fWrittenSeen = event.seen;
+  fFileEvents++;
+
+  // Start the next file between events, so no event is split
+  if ((fFlushEvents > 0 && fFileEvents >= fFlushEvents) ||
+      (fFlushMB > 0. && fFileBytes >= fFlushMB * 1024. * 1024.)) {
+    NextFile();
+  }
+
+  fWriteTime += std::chrono::duration<G4double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::WriteRow(G4int ntuple, const Hit& hit)
+{
+  auto man = fManager;
+  const auto& id = fColumnId[ntuple];
+
+  if (id[kEventID] >= 0) man->FillNtupleIColumn(ntuple, id[kEventID], hit.eventID);
+  if (id[kPDG] >= 0) man->FillNtupleIColumn(ntuple, id[kPDG], hit.pdg);
+  if (id[kX] >= 0) man->FillNtupleDColumn(ntuple, id[kX], hit.position.x() / mm);
+  if (id[kY] >= 0) man->FillNtupleDColumn(ntuple, id[kY], hit.position.y() / mm);
+  if (id[kZ] >= 0) man->FillNtupleDColumn(ntuple, id[kZ], hit.position.z() / mm);
+  if (id[kPx] >= 0) man->FillNtupleDColumn(ntuple, id[kPx], hit.momentum.x() / MeV);
+  if (id[kPy] >= 0) man->FillNtupleDColumn(ntuple, id[kPy], hit.momentum.y() / MeV);
+  if (id[kPz] >= 0) man->FillNtupleDColumn(ntuple, id[kPz], hit.momentum.z() / MeV);
+  if (id[kEkin] >= 0) man->FillNtupleDColumn(ntuple, id[kEkin], hit.ekin / eV);
+  if (id[kPlane] >= 0) man->FillNtupleIColumn(ntuple, id[kPlane], hit.plane);
+  man->AddNtupleRow(ntuple);
+
+  fWritten[ntuple]++;
+  fFileBytes += fRowBytes[ntuple];
+  fRunBytes += fRowBytes[ntuple];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String HitOutput::GetFileName() const
+{
+  // Geant4 adds the extension, and worker threads their own _t<N> suffix
+  G4String name = Replace(fFileName, "%run", std::to_string(fRunID));
+  if (name.find("%part") != G4String::npos) {
+    return Replace(name, "%part", std::to_string(fFile));
+  }
+  if (fFile == 0) return name;
+  return name + "_" + std::to_string(fFile);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::AddFilePaths(const G4String& fileName)
+{
+  // As Geant4 names them: worker threads add _t<N> before the extension,
+  // and csv and xml have a file per ntuple (and csv per histogram)
+  G4String suffix;
+  if (G4Threading::IsWorkerThread()) suffix = "_t" + std::to_string(G4Threading::G4GetThreadId());
+  G4String extension = "." + fFileType;
+
+  if (fFileType == "root" || fFileType == "hdf5" || fFileType == "xml") {
+    fFilePaths.push_back(fileName + suffix + extension);
+  }
+  if (fFileType == "csv" || fFileType == "xml") {
+    std::vector<G4String> ntuples = {ntupleNames[kWindowHits], ntupleNames[kPlaneHits], "planes",
+                                     "prescale", "events"};
+    if (fFateColumns) ntuples.push_back("fates");
+    for (const auto& ntuple : ntuples) {
+      fFilePaths.push_back(fileName + "_nt_" + ntuple + suffix + extension);
+    }
+  }
+  if (fFileType == "csv") {
+    for (G4int i = 0; i < fImages.GetNumberOfImages(); i++) {
+      fFilePaths.push_back(fileName + "_h2_" + PlaneImages::GetName(i) + suffix + extension);
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::AddFileSizes()
+{
+  // A thread may not have written all of them, eg the master in MT has no
+  // ntuple rows
+  std::error_code error;
+  for (const auto& path : fFilePaths) {
+    auto size = std::filesystem::file_size(static_cast<const std::string&>(path), error);
+    if (error) continue;
+    fDiskBytes += size;
+    fDiskFiles += 1;
+  }
+  fFilePaths.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::ReportFileSize() const
+{
+  G4cout << " Output files of run " << fRunID << ": " << fDiskFiles.GetValue() << " files, "
+         << fDiskBytes.GetValue() / (1024. * 1024.) << " MB on disk" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::OpenFile()
+{
+  auto fileName = GetFileName();
+  fManager->OpenFile(fileName);
+  AddFilePaths(fileName);
+
+  fFileEvents = 0;
+  fFileBytes = 0.;
+  fFileSeen = fWrittenSeen;
+  fFileWritten = fWritten;
+
+  WritePlanes();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::CloseFile()
+{
+  WritePrescale();
+
+  fManager->Write();
+  // Frees the rows and baskets of this file, so memory does not grow with the run
+  fManager->CloseFile();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::NextFile()
+{
+  CloseFile();
+  fFile++;
+  OpenFile();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::WritePlanes()
+{
+  // Write the plane layout wherever hits are written, so that every output
+  // file describes its own geometry.
+  if (!fWritesHits) return;
+
+  auto man = fManager;
+  for (G4int i = 0; i < fDetConstruction->GetNumberOfPlanes(); i++) {
+    man->FillNtupleIColumn(kPlanes, 0, i);
+    man->FillNtupleDColumn(kPlanes, 1, fDetConstruction->GetPlaneZ(i) / mm);
+    man->FillNtupleDColumn(kPlanes, 2, fDetConstruction->GetPlaneRMin() / mm);
+    man->FillNtupleDColumn(kPlanes, 3, fDetConstruction->GetPlaneRMax() / mm);
+    man->AddNtupleRow(kPlanes);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::WritePrescale()
+{
+  // The hits of this file only, so that split files add up to the run
+  if (!fWritesHits) return;
+
+  auto man = fManager;
+  for (G4int ntuple : {kWindowHits, kPlaneHits}) {
+    G4double seen = fWrittenSeen[ntuple] - fFileSeen[ntuple];
+    G4double written = fWritten[ntuple] - fFileWritten[ntuple];
+    man->FillNtupleSColumn(kPrescale, 0, ntupleNames[ntuple]);
+    man->FillNtupleIColumn(kPrescale, 1, fPrescale[ntuple]);
+    man->FillNtupleDColumn(kPrescale, 2, seen);
+    man->FillNtupleDColumn(kPrescale, 3, written);
+    man->FillNtupleDColumn(kPrescale, 4, seen > 0. ? written / seen : 1.);
+    man->AddNtupleRow(kPrescale);
+  }
+}
+
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::SetWindowColumns(G4String columns)
+{
+  SetColumns(kWindowHits, columns);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::SetHitColumns(G4String columns)
+{
+  SetColumns(kPlaneHits, columns);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::SetColumns(G4int ntuple, const G4String& columns)
+{
+  if (fBooked) {
+    G4ExceptionDescription msg;
+    msg << "The columns of " << ntupleNames[ntuple] << " are booked at the first run"
+        << " and can't be changed after it. The command is ignored.";
+    G4Exception("HitOutput::SetColumns()", "MyCode0004", JustWarning, msg);
+    return;
+  }
+
+  std::array<G4bool, kNColumns> selected;
+  selected.fill(false);
+
+  // Names separated by commas or spaces, or "all"
+  G4Tokenizer next(columns);
+  G4String name;
+  while (!(name = next(", ")).empty()) {
+    G4bool found = false;
+    for (G4int column = 0; column < kNColumns; column++) {
+      if (name == "all" || name == columnNames[column]) {
+        selected[column] = true;
+        found = true;
+      }
+    }
+    if (!found) {
+      G4ExceptionDescription msg;
+      msg << "Unknown column " << name << " for " << ntupleNames[ntuple] << ". The command is ignored.";
+      G4Exception("HitOutput::SetColumns()", "MyCode0004", JustWarning, msg);
+      return;
+    }
+  }
+
+  // Only the planes have a plane number
+  if (ntuple == kWindowHits) selected[kPlane] = false;
+
+  fSelected[ntuple] = selected;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::SetFileType(G4String type)
+{
+  if (fBooked && type != fFileType) {
+    G4ExceptionDescription msg;
+    msg << "The ntuples were created for " << fFileType << " files at the first run"
+        << " and can't change backend after it. The command is ignored.";
+    G4Exception("HitOutput::SetFileType()", "MyCode0004", JustWarning, msg);
+    return;
+  }
+  fFileType = type;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutput::DefineCommands()
+{
+  // Define /waterRadiator/output command directory using generic messenger class
+  fMessenger = new G4GenericMessenger(this, "/waterRadiator/output/", "Output control");
+
+  auto& fileTypeCmd = fMessenger->DeclareMethod("fileType", &HitOutput::SetFileType,
+    "Output backend. Takes effect only before the first run.");
+  fileTypeCmd.SetParameterName("type", false);
+  fileTypeCmd.SetCandidates("root hdf5 csv xml");
+
+  auto& fileNameCmd = fMessenger->DeclareProperty("fileName", fFileName,
+    "Output file name without extension. %run is replaced by the run number and\n"
+    "%part by the index of the file when the output is split.");
+  fileNameCmd.SetParameterName("name", false);
+
+  auto& windowColumnsCmd = fMessenger->DeclareMethod("windowColumns", &HitOutput::SetWindowColumns,
+    "Columns written to windowhits, separated by commas, or all.\n"
+    "Choose from eventID,pdg,x,y,z,px,py,pz,ekin. Takes effect only before the first run.");
+  windowColumnsCmd.SetParameterName("columns", false);
+
+  auto& hitColumnsCmd = fMessenger->DeclareMethod("hitColumns", &HitOutput::SetHitColumns,
+    "Columns written to hits, separated by commas, or all.\n"
+    "Choose from eventID,pdg,x,y,z,px,py,pz,ekin,plane. Takes effect only before the first run.");
+  hitColumnsCmd.SetParameterName("columns", false);
+
+  auto& windowPrescaleCmd = fMessenger->DeclareProperty("windowPrescale", fPrescale[kWindowHits],
+    "Write 1 in N window hits. The fraction written is stored in the prescale ntuple.");
+  windowPrescaleCmd.SetParameterName("N", true);
+  windowPrescaleCmd.SetRange("N>=1");
+  windowPrescaleCmd.SetDefaultValue("1");
+
+  auto& hitPrescaleCmd = fMessenger->DeclareProperty("hitPrescale", fPrescale[kPlaneHits],
+    "Write 1 in N detector plane hits. The fraction written is stored in the prescale ntuple.");
+  hitPrescaleCmd.SetParameterName("N", true);
+  hitPrescaleCmd.SetRange("N>=1");
+  hitPrescaleCmd.SetDefaultValue("1");
+
+  auto& compressionCmd = fMessenger->DeclareProperty("compression", fCompression,
+    "Compression level of root and hdf5 files (0: none), with zlib.");
+  compressionCmd.SetParameterName("level", true);
+  compressionCmd.SetRange("level>=0 && level<=9");
+  compressionCmd.SetDefaultValue("1");
+
+  auto& basketCmd = fMessenger->DeclareProperty("basketSize", fBasketSize,
+    "Size of the buffer each column of a root file fills before it is compressed and\n"
+    "written, in kB. Memory per file is about this times the number of columns.");
+  basketCmd.SetParameterName("kB", true);
+  basketCmd.SetRange("kB>=1");
+  basketCmd.SetDefaultValue("32");
+
+  auto& flushEventsCmd = fMessenger->DeclareProperty("flushEvents", fFlushEvents,
+    "Close the output file and start the next one every N events (0: never).\n"
+    "Files after the first get _<i> after the name, unless it has %part.");
+  flushEventsCmd.SetParameterName("N", true);
+  flushEventsCmd.SetRange("N>=0");
+  flushEventsCmd.SetDefaultValue("0");
+
+  auto& flushMBCmd = fMessenger->DeclareProperty("flushMB", fFlushMB,
+    "Close the output file and start the next one after M MB of hits, before\n"
+    "compression (0: never).");
+  flushMBCmd.SetParameterName("M", true);
+  flushMBCmd.SetRange("M>=0");
+  flushMBCmd.SetDefaultValue("0");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}  // namespace B1
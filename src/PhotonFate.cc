@@ -0,0 +1,250 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file PhotonFate.cc
+/// \brief Implementation of the B1::PhotonFate class
+
+#include "PhotonFate.hh"
+
+#include "G4AccumulableManager.hh"
+#include "G4GenericMessenger.hh"
+#include "G4LogicalVolume.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4Step.hh"
+#include "G4Threading.hh"
+#include "G4VPhysicalVolume.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+namespace B1
+{
+
+const char* const PhotonFate::eventColumnNames[kNEventColumns] = {
+  "generated", "reachedPlanes", "absorbedBulk", "absorbedSurface", "escaped", "steps"};
+
+namespace
+{
+const char* fateNames[PhotonFate::kNFates] = {"absorbed in", "absorbed at", "escaped"};
+
+G4String Name(const G4LogicalVolume* volume)
+{
+  return volume ? volume->GetName() : G4String("(none)");
+}
+}  // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PhotonFate::PhotonFate()
+{
+  G4AccumulableManager::Instance()->Register(&fBudget);
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PhotonFate::~PhotonFate()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonFate::BeginOfRun(const G4LogicalVolume* detectorVolume)
+{
+  fDetectorVolume = detectorVolume;
+  fLast = Clock::now();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonFate::BeginOfEvent()
+{
+  fEventCounts.fill(0);
+  fLast = Clock::now();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonFate::Step(const G4Step* step)
+{
+  auto now = Clock::now();
+  auto elapsed = now - fLast;
+  fLast = now;
+
+  const G4Track* track = step->GetTrack();
+  if (track->GetDefinition() != G4OpticalPhoton::Definition()) return;
+
+  // The steps of a track are consecutive, so one photon is open at a time
+  if (track->GetCurrentStepNumber() == 1) {
+    fCreation = track->GetLogicalVolumeAtVertex();
+    fReached = false;
+    fSteps = 0;
+    fTime = Clock::duration(0);
+    fEventCounts[kGenerated]++;
+  }
+  fSteps++;
+  fTime += elapsed;
+  fEventCounts[kSteps]++;
+
+  // Entering a detector plane, where PlaneSD records it
+  auto post = step->GetPostStepPoint();
+  auto postVolume = post->GetPhysicalVolume();
+  if (!fReached && post->GetStepStatus() == fGeomBoundary && postVolume
+      && postVolume->GetLogicalVolume() == fDetectorVolume) {
+    fReached = true;
+  }
+
+  if (track->GetTrackStatus() == fAlive) return;
+
+  // Killed at a boundary, the photon was absorbed by the surface of the
+  // volume it was entering; elsewhere by the bulk of the one it was in
+  G4int fate;
+  const G4LogicalVolume* where = nullptr;
+  if (!postVolume) {
+    fate = kEscaped;
+    fEventCounts[kEscapedWorld]++;
+  }
+  else if (post->GetStepStatus() == fGeomBoundary) {
+    fate = kAbsorbedAt;
+    where = postVolume->GetLogicalVolume();
+    fEventCounts[kAbsorbedSurface]++;
+  }
+  else {
+    fate = kAbsorbedIn;
+    where = step->GetPreStepPoint()->GetPhysicalVolume()->GetLogicalVolume();
+    fEventCounts[kAbsorbedBulk]++;
+  }
+  if (fReached) fEventCounts[kReachedPlanes]++;
+
+  auto& tally = fBudget.tallies[Key(fCreation, fate, where)];
+  tally.photons++;
+  if (fReached) tally.reachedPlanes++;
+  tally.steps += fSteps;
+  tally.time += fTime;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonFate::EndOfRun()
+{
+  // RunAction merges the workers' budgets into the master's, which prints
+  if (!IsEnabled() || G4Threading::IsWorkerThread()) return;
+  Print();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonFate::Budget::Merge(const G4VAccumulable& other)
+{
+  for (const auto& [key, tally] : static_cast<const Budget&>(other).tallies) {
+    auto& total = tallies[key];
+    total.photons += tally.photons;
+    total.reachedPlanes += tally.reachedPlanes;
+    total.steps += tally.steps;
+    total.time += tally.time;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonFate::Budget::Reset()
+{
+  tallies.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#if G4VERSION_NUMBER >= 1120
+void PhotonFate::Budget::Print(G4PrintOptions) const
+{
+  G4cout << GetName() << ": " << tallies.size() << " creation volume and fate tallies"
+         << G4endl;
+}
+#endif
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonFate::Print() const
+{
+  Tally total, reached;
+  std::vector<std::pair<Key, Tally>> rows(fBudget.tallies.begin(), fBudget.tallies.end());
+  for (const auto& [key, tally] : rows) {
+    total.photons += tally.photons;
+    total.steps += tally.steps;
+    total.time += tally.time;
+    reached.photons += tally.reachedPlanes;
+  }
+  if (total.photons == 0) return;
+  std::sort(rows.begin(), rows.end(),
+            [](const auto& a, const auto& b) { return a.second.time > b.second.time; });
+
+  auto seconds = [](Clock::duration time) { return std::chrono::duration<G4double>(time).count(); };
+  G4double totalSeconds = seconds(total.time);
+
+  G4cout << G4endl << "--------------------Photon fates--------------------------" << G4endl
+         << std::setw(16) << "created in" << std::setw(28) << "fate" << std::setw(12)
+         << "photons" << std::setw(7) << "%" << std::setw(12) << "reached" << std::setw(14)
+         << "steps" << std::setw(7) << "%" << std::setw(10) << "time(s)" << std::setw(7) << "%"
+         << G4endl;
+  for (const auto& [key, tally] : rows) {
+    G4String fate = fateNames[std::get<1>(key)];
+    if (std::get<1>(key) != kEscaped) fate += " " + Name(std::get<2>(key));
+    G4cout << std::setw(16) << Name(std::get<0>(key)) << std::setw(28) << fate << std::setw(12)
+           << tally.photons << std::fixed << std::setprecision(1) << std::setw(7)
+           << 100. * tally.photons / total.photons << std::setw(12) << tally.reachedPlanes
+           << std::setw(14) << tally.steps << std::setw(7)
+           << (total.steps > 0 ? 100. * tally.steps / total.steps : 0.) << std::setprecision(3)
+           << std::setw(10) << seconds(tally.time) << std::setprecision(1) << std::setw(7)
+           << (totalSeconds > 0. ? 100. * seconds(tally.time) / totalSeconds : 0.)
+           << std::defaultfloat << std::setprecision(6) << G4endl;
+  }
+  G4cout << " " << total.photons << " photons, " << reached.photons << " ("
+         << 100. * reached.photons / total.photons << "%) reached a detector plane; "
+         << total.steps << " steps, " << totalSeconds << " s" << G4endl << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonFate::DefineCommands()
+{
+  // Define /waterRadiator/fate command directory using generic messenger class
+  fMessenger = new G4GenericMessenger(this, "/waterRadiator/fate/", "Optical photon fates");
+
+  auto& enableCmd = fMessenger->DeclareProperty("enable", fEnabled,
+    "Count the optical photons by creation volume and fate, printed at the end of each run.");
+  enableCmd.SetParameterName("enable", true);
+  enableCmd.SetDefaultValue("true");
+
+  auto& eventCmd = fMessenger->DeclareProperty("eventColumns", fEventColumns,
+    "Also write the fates of each event to the fates ntuple (before the first run).");
+  eventCmd.SetParameterName("eventColumns", true);
+  eventCmd.SetDefaultValue("true");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}  // namespace B1
@@ -0,0 +1,133 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file PlaneImages.cc
+/// \brief Implementation of the B1::PlaneImages class
+
+#include "PlaneImages.hh"
+
+#include "DetectorConstruction.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+
+namespace B1
+{
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PlaneImages::PlaneImages()
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PlaneImages::~PlaneImages()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PlaneImages::Book(G4AnalysisManager* man, const DetectorConstruction* detConstruction)
+{
+  if (fBooked || !fEnabled) return;
+  fBooked = true;
+
+  if (fHalfWidth <= 0.) fHalfWidth = detConstruction->GetPlaneRMax();
+  fInvBinWidth = fBins / (2. * fHalfWidth);
+
+  G4int nPlanes = detConstruction->GetNumberOfPlanes();
+  for (G4int i = 0; i < nPlanes; i++) {
+    G4String title = "Photons on plane " + std::to_string(i) + " (z = "
+                     + std::to_string(G4int(detConstruction->GetPlaneZ(i) / mm)) + " mm);x (mm);y (mm)";
+    G4int id = man->CreateH2(GetName(i), title, fBins, -fHalfWidth / mm, fHalfWidth / mm,
+                             fBins, -fHalfWidth / mm, fHalfWidth / mm);
+    if (i == 0) fFirstId = id;
+  }
+
+  fImages.assign(nPlanes, std::vector<G4double>(fBins * fBins, 0.));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PlaneImages::BeginOfRun()
+{
+  for (auto& image : fImages) std::fill(image.begin(), image.end(), 0.);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PlaneImages::EndOfRun(G4AnalysisManager* man)
+{
+  if (!fBooked) return;
+
+  // One weighted fill per bin at its centre
+  G4double binWidth = 2. * fHalfWidth / fBins;
+  for (size_t plane = 0; plane < fImages.size(); plane++) {
+    const auto& image = fImages[plane];
+    for (G4int iy = 0; iy < fBins; iy++) {
+      for (G4int ix = 0; ix < fBins; ix++) {
+        G4double count = image[iy * fBins + ix];
+        if (count == 0.) continue;
+        man->FillH2(fFirstId + plane, (-fHalfWidth + (ix + 0.5) * binWidth) / mm,
+                    (-fHalfWidth + (iy + 0.5) * binWidth) / mm, count);
+      }
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PlaneImages::DefineCommands()
+{
+  // Define /waterRadiator/images command directory using generic messenger class
+  fMessenger = new G4GenericMessenger(this, "/waterRadiator/images/", "Detector plane images");
+
+  auto& enableCmd = fMessenger->DeclareProperty("enable", fEnabled,
+    "Make an x-y image of the photons on each detector plane. Takes effect only before the first run.");
+  enableCmd.SetParameterName("enable", true);
+  enableCmd.SetDefaultValue("true");
+
+  auto& binsCmd = fMessenger->DeclareProperty("bins", fBins,
+    "Bins per axis of the images. Takes effect only before the first run.");
+  binsCmd.SetParameterName("bins", true);
+  binsCmd.SetRange("bins>=1");
+  binsCmd.SetDefaultValue("200");
+
+  auto& widthCmd = fMessenger->DeclarePropertyWithUnit("halfWidth", "mm", fHalfWidth,
+    "Half width of the square images, centred on the axis (0: the outer radius of the planes).\n"
+    "Takes effect only before the first run.");
+  widthCmd.SetParameterName("halfWidth", true);
+  widthCmd.SetRange("halfWidth>=0.");
+  widthCmd.SetDefaultValue("0.");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}  // namespace B1
@@ -27,10 +27,13 @@
 /// \brief Implementation of the B1::PrimaryGeneratorAction class
 
 #include "PrimaryGeneratorAction.hh"
+#include "GeometryParameters.hh"
 
 #include "G4Box.hh"
+#include "G4GenericMessenger.hh"
 #include "G4LogicalVolume.hh"
 #include "G4LogicalVolumeStore.hh"
+#include "G4OpticalPhoton.hh"
 #include "G4ParticleGun.hh"
 #include "G4ParticleTable.hh"
 #include "G4SystemOfUnits.hh"
@@ -53,6 +56,9 @@ PrimaryGeneratorAction::PrimaryGeneratorAction()
   fParticleGun->SetParticleDefinition(particle);
   fParticleGun->SetParticleMomentumDirection(G4ThreeVector(0., 0., 1.));
   fParticleGun->SetParticleEnergy(8. * GeV);
+
+  fPhotonEnergy = 3. * eV;
+  DefineCommands();
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -60,6 +66,7 @@ PrimaryGeneratorAction::PrimaryGeneratorAction()
 PrimaryGeneratorAction::~PrimaryGeneratorAction()
 {
   delete fParticleGun;
+  delete fMessenger;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -69,6 +76,11 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* event)
   // this function is called at the begining of ecah event
   //
 
+  if (fNPhotons > 0) {
+    GeneratePhotons(event);
+    return;
+  }
+
   // In order to avoid dependence of PrimaryGeneratorAction
   // on DetectorConstruction class we get Envelope volume
   // from G4LogicalVolumeStore.
@@ -93,7 +105,7 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* event)
     G4Exception("PrimaryGeneratorAction::GeneratePrimaries()", "MyCode0002", JustWarning, msg);
   }
 
-  G4double size = 6.*mm; // Beam size
+  G4double size = Geometry::beamSigma; // Beam size
   G4double x0 = G4RandGauss::shoot(0.,size);
   G4double y0 = G4RandGauss::shoot(0.,size);
   G4double z0 = -0.5 * envSizeZ;
@@ -105,4 +117,52 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* event)
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void PrimaryGeneratorAction::GeneratePhotons(G4Event* event)
+{
+  // Photons from points along the beam, spread like the beam, on the
+  // Cherenkov cone, polarized in the plane of the cone as Cherenkov light is.
+  // The gun keeps the proton settings for when the photons are switched off.
+  G4ParticleGun photonGun(1);
+  photonGun.SetParticleDefinition(G4OpticalPhoton::Definition());
+  photonGun.SetParticleEnergy(fPhotonEnergy);
+
+  G4double size = Geometry::beamSigma; // Beam size
+  G4double lightAngle = Geometry::cherenkovAngle;
+  for (G4int i = 0; i < fNPhotons; i++) {
+    G4double phi = twopi * G4UniformRand();
+    G4ThreeVector direction(std::sin(lightAngle) * std::cos(phi),
+                            std::sin(lightAngle) * std::sin(phi), std::cos(lightAngle));
+    G4ThreeVector polarization(std::cos(lightAngle) * std::cos(phi),
+                               std::cos(lightAngle) * std::sin(phi), -std::sin(lightAngle));
+    photonGun.SetParticlePosition(G4ThreeVector(G4RandGauss::shoot(0., size),
+                                                G4RandGauss::shoot(0., size),
+                                                Geometry::radiatorLength * G4UniformRand()));
+    photonGun.SetParticleMomentumDirection(direction);
+    photonGun.SetParticlePolarization(polarization);
+    photonGun.GeneratePrimaryVertex(event);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryGeneratorAction::DefineCommands()
+{
+  // Define /waterRadiator/gun command directory using generic messenger class
+  fMessenger = new G4GenericMessenger(this, "/waterRadiator/gun/", "Primary generator control");
+
+  auto& photonsCmd = fMessenger->DeclareProperty("photons", fNPhotons,
+    "Optical photons per event on the Cherenkov cone inside the radiator (0: proton beam).");
+  photonsCmd.SetParameterName("n", true);
+  photonsCmd.SetRange("n>=0");
+  photonsCmd.SetDefaultValue("0");
+
+  auto& energyCmd = fMessenger->DeclarePropertyWithUnit("photonEnergy", "eV", fPhotonEnergy,
+    "Energy of the optical photons of /waterRadiator/gun/photons.");
+  energyCmd.SetParameterName("energy", true);
+  energyCmd.SetRange("energy>0.");
+  energyCmd.SetDefaultValue("3.");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 }  // namespace B1
@@ -0,0 +1,170 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ProcessTimer.cc
+/// \brief Implementation of the B1::ProcessTimer and B1::ProcessTimerPhysics classes
+
+#include "ProcessTimer.hh"
+
+#include "G4EmProcessSubType.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ProcessManager.hh"
+#include "G4ProcessVector.hh"
+
+#include <map>
+
+namespace B1
+{
+
+G4bool ProcessTimer::fEnabled = false;
+
+namespace
+{
+G4ThreadLocal std::vector<ProcessTimer*>* timers = nullptr;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ProcessTimer::ProcessTimer(G4VProcess* process)
+  : G4WrapperProcess(process->GetProcessName(), process->GetProcessType())
+{
+  SetProcessSubType(process->GetProcessSubType());
+  RegisterProcess(process);
+  // RegisterProcess appends the wrapped name to ours; keep the process's own
+  // name for /process/ commands and the profile
+  SetProcessName(process->GetProcessName());
+  if (!timers) timers = new std::vector<ProcessTimer*>;
+  timers->push_back(this);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ProcessTimer::~ProcessTimer()
+{
+  // The wrapped process is still in the process table, which deletes it
+  pRegProcess = nullptr;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ProcessTimer::PostStepGetPhysicalInteractionLength(const G4Track& track,
+                                                            G4double previousStepSize,
+                                                            G4ForceCondition* condition)
+{
+  auto start = Clock::now();
+  G4double length =
+    pRegProcess->PostStepGetPhysicalInteractionLength(track, previousStepSize, condition);
+  fPostStepGPIL.calls++;
+  fPostStepGPIL.time += Clock::now() - start;
+  return length;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VParticleChange* ProcessTimer::AlongStepDoIt(const G4Track& track, const G4Step& step)
+{
+  auto start = Clock::now();
+  G4VParticleChange* change = pRegProcess->AlongStepDoIt(track, step);
+  fAlongStepDoIt.calls++;
+  fAlongStepDoIt.time += Clock::now() - start;
+  return change;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VParticleChange* ProcessTimer::PostStepDoIt(const G4Track& track, const G4Step& step)
+{
+  auto start = Clock::now();
+  G4VParticleChange* change = pRegProcess->PostStepDoIt(track, step);
+  fPostStepDoIt.calls++;
+  fPostStepDoIt.time += Clock::now() - start;
+  return change;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ProcessTimer::Reset()
+{
+  fPostStepGPIL = Counter();
+  fAlongStepDoIt = Counter();
+  fPostStepDoIt = Counter();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const std::vector<ProcessTimer*>& ProcessTimer::Timers()
+{
+  if (!timers) timers = new std::vector<ProcessTimer*>;
+  return *timers;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ProcessTimerPhysics::ProcessTimerPhysics() : G4VPhysicsConstructor("ProcessTimer") {}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ProcessTimerPhysics::ConstructProcess()
+{
+  if (!ProcessTimer::IsEnabled()) return;
+
+  // Cherenkov and scintillation are single instances shared by all the
+  // charged particles, so each process gets one wrapper, used everywhere.
+  std::map<G4VProcess*, ProcessTimer*> wrappers;
+
+  auto particleIterator = GetParticleIterator();
+  particleIterator->reset();
+  while ((*particleIterator)()) {
+    G4ProcessManager* manager = particleIterator->value()->GetProcessManager();
+    if (!manager) continue;
+
+    // Copy the list, as it changes with each replacement
+    std::vector<G4VProcess*> processes;
+    G4ProcessVector* list = manager->GetProcessList();
+    for (std::size_t i = 0; i < list->size(); i++) processes.push_back((*list)[i]);
+
+    for (auto process : processes) {
+      G4bool optical = process->GetProcessType() == fOptical
+                       || process->GetProcessSubType() == fCerenkov
+                       || process->GetProcessSubType() == fScintillation;
+      if (!optical) continue;
+
+      // Re-add the wrapper with the ordering the process had
+      G4int ordAtRest = manager->GetProcessOrdering(process, idxAtRest);
+      G4int ordAlongStep = manager->GetProcessOrdering(process, idxAlongStep);
+      G4int ordPostStep = manager->GetProcessOrdering(process, idxPostStep);
+      auto& wrapper = wrappers[process];
+      if (!wrapper) wrapper = new ProcessTimer(process);
+      manager->RemoveProcess(process);
+      manager->AddProcess(wrapper, ordAtRest, ordAlongStep, ordPostStep);
+    }
+  }
+
+  G4cout << "ProcessTimerPhysics: timing " << wrappers.size() << " optical processes" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}  // namespace B1
@@ -0,0 +1,219 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file Progress.cc
+/// \brief Implementation of the B1::Progress class
+
+#include "Progress.hh"
+
+#include "G4AutoLock.hh"
+#include "G4GenericMessenger.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace B1
+{
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// The run as a whole, shared by the threads
+G4Mutex progressMutex = G4MUTEX_INITIALIZER;
+std::vector<const Progress*> threads;  // those that count events
+std::atomic<G4long> totalEvents{0};
+std::atomic<G4long> totalPhotons{0};
+std::atomic<Clock::rep> nextReport{0};
+Clock::time_point runStart;
+G4int runNumber = 0;
+G4long eventsToProcess = 0;
+
+G4String FormatTime(G4double seconds)
+{
+  auto total = static_cast<G4long>(seconds + 0.5);
+  std::ostringstream text;
+  text << total / 3600 << ":" << std::setfill('0') << std::setw(2) << total / 60 % 60 << ":"
+       << std::setw(2) << total % 60;
+  return text.str();
+}
+}  // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Progress::Progress()
+{
+  fInterval = 30. * s;
+
+  // The workers in MT, or the only thread
+  fCounts = G4Threading::IsWorkerThread() || !G4Threading::IsMultithreadedApplication();
+  fThread = std::max(0, G4Threading::G4GetThreadId());
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Progress::~Progress()
+{
+  G4AutoLock lock(&progressMutex);
+  threads.erase(std::remove(threads.begin(), threads.end(), this), threads.end());
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Progress::BeginOfRun(G4int runID, G4int nEvents)
+{
+  fEvents = 0;
+
+  // The master starts its run before the workers start theirs
+  if (!G4Threading::IsWorkerThread()) {
+    G4AutoLock lock(&progressMutex);
+    runStart = Clock::now();
+    runNumber = runID;
+    eventsToProcess = nEvents;
+    totalEvents = 0;
+    totalPhotons = 0;
+    auto interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<G4double>(fInterval / s));
+    nextReport = (runStart + interval).time_since_epoch().count();
+  }
+
+  if (fCounts) {
+    G4AutoLock lock(&progressMutex);
+    if (std::find(threads.begin(), threads.end(), this) == threads.end()) {
+      threads.push_back(this);
+      std::sort(threads.begin(), threads.end(),
+                [](const Progress* a, const Progress* b) { return a->fThread < b->fThread; });
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Progress::EndOfEvent(G4long nPhotons)
+{
+  fEvents.fetch_add(1, std::memory_order_relaxed);
+  totalEvents.fetch_add(1, std::memory_order_relaxed);
+  totalPhotons.fetch_add(nPhotons, std::memory_order_relaxed);
+  if (fInterval <= 0.) return;
+
+  // One thread wins each report
+  auto now = Clock::now();
+  auto next = nextReport.load(std::memory_order_relaxed);
+  if (now.time_since_epoch().count() < next) return;
+  auto interval = std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<G4double>(fInterval / s));
+  if (!nextReport.compare_exchange_strong(next, (now + interval).time_since_epoch().count())) {
+    return;
+  }
+  Report(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Progress::EndOfRun()
+{
+  // The final status, once the workers are done
+  if (!G4Threading::IsWorkerThread()) Report(true);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Progress::Report(G4bool done) const
+{
+  G4AutoLock lock(&progressMutex);
+
+  G4double elapsed = std::chrono::duration<G4double>(Clock::now() - runStart).count();
+  G4long events = totalEvents;
+  G4long photons = totalPhotons;
+  G4double rate = elapsed > 0. ? events / elapsed : 0.;
+  G4double eta = rate > 0. ? (eventsToProcess - events) / rate : 0.;
+
+  if (!done) {
+    G4cout << " Progress: run " << runNumber << ", " << events << " of " << eventsToProcess
+           << " events (" << std::fixed << std::setprecision(1)
+           << (eventsToProcess > 0 ? 100. * events / eventsToProcess : 0.) << "%) in "
+           << FormatTime(elapsed) << ", " << rate << " events/s, " << std::setprecision(0)
+           << (elapsed > 0. ? photons / elapsed : 0.) << " photons/s, ETA " << FormatTime(eta);
+    if (threads.size() > 1) {
+      G4cout << "; events/s per thread:" << std::setprecision(1);
+      for (auto thread : threads) G4cout << " " << (elapsed > 0. ? thread->fEvents / elapsed : 0.);
+    }
+    G4cout << std::defaultfloat << std::setprecision(6) << G4endl;
+  }
+
+  if (fStatusFile.empty()) return;
+
+  // Renaming over the old file is atomic, so a reader sees one or the other
+  G4String temporary = fStatusFile + ".tmp";
+  {
+    std::ofstream out(temporary);
+    if (!out) return;
+    out << "{\"run\": " << runNumber << ", \"state\": \"" << (done ? "done" : "running")
+        << "\", \"events\": " << events << ", \"eventsToProcess\": " << eventsToProcess
+        << ", \"elapsedSeconds\": " << elapsed << ", \"eventsPerSecond\": " << rate
+        << ", \"photonsPerSecond\": " << (elapsed > 0. ? photons / elapsed : 0.)
+        << ", \"etaSeconds\": " << (done ? 0. : eta) << ", \"threads\": [";
+    for (std::size_t i = 0; i < threads.size(); i++) {
+      G4long threadEvents = threads[i]->fEvents;
+      out << (i > 0 ? ", " : "") << "{\"thread\": " << threads[i]->fThread
+          << ", \"events\": " << threadEvents
+          << ", \"eventsPerSecond\": " << (elapsed > 0. ? threadEvents / elapsed : 0.) << "}";
+    }
+    out << "]}" << std::endl;
+  }
+  std::rename(temporary.c_str(), fStatusFile.c_str());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Progress::DefineCommands()
+{
+  // Define /waterRadiator/progress command directory using generic messenger class
+  fMessenger = new G4GenericMessenger(this, "/waterRadiator/progress/", "Run progress");
+
+  auto& intervalCmd = fMessenger->DeclarePropertyWithUnit("interval", "s", fInterval,
+    "Time between progress reports during a run (0: off).");
+  intervalCmd.SetParameterName("interval", true);
+  intervalCmd.SetRange("interval>=0.");
+  intervalCmd.SetDefaultValue("30.");
+
+  auto& fileCmd = fMessenger->DeclareProperty("statusFile", fStatusFile,
+    "Keep the progress of the run in this JSON file (empty: none).");
+  fileCmd.SetParameterName("file", true);
+  fileCmd.SetDefaultValue("");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}  // namespace B1
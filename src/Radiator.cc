@@ -9,6 +9,7 @@
 //
 
 #include "Radiator.hh" 
+#include "GeometryParameters.hh"
 #include <cmath>
 #include "G4ios.hh"
 
@@ -17,8 +18,7 @@
 //
 Radiator::Radiator(MyMaterials *mat,G4double beamRadius, G4double lenRadiator,
     G4double windowThickness) {
-   // Cerenkov angle of 8 GeV protons in water
-   const G4double lightAngle=0.713532378;
+   const G4double lightAngle=B1::Geometry::cherenkovAngle;
    // I'm putting all the z positions in one array, but they are not in order
    // The first three define the radiator polycone and the next three define
    // the window, which starts at the second point of the radiator
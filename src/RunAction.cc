@@ -28,8 +28,13 @@
 
 #include "RunAction.hh"
 
+#include "Benchmark.hh"
 #include "DetectorConstruction.hh"
+#include "HitOutput.hh"
+#include "PhotonFate.hh"
 #include "PrimaryGeneratorAction.hh"
+#include "Progress.hh"
+#include "StepProfiler.hh"
 
 #include "G4AccumulableManager.hh"
 #include "G4LogicalVolume.hh"
@@ -39,7 +44,6 @@
 #include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4UnitsTable.hh"
-#include "G4AnalysisManager.hh"
 #include "G4ios.hh"
 
 namespace B1
@@ -65,43 +69,33 @@ RunAction::RunAction()
   G4AccumulableManager* accumulableManager = G4AccumulableManager::Instance();
   accumulableManager->Register(fEdep);
   accumulableManager->Register(fEdep2);
+  accumulableManager->Register(fNPhotons);
+  accumulableManager->Register(fNPhotonSteps);
   
-  // Create an Ntuple to store hits
-  G4cout << "About to create Ntuple "<<std::endl;
-  auto man = G4AnalysisManager::Instance();
-  man->SetDefaultFileType("root");
-  man->SetFileName("surface_hits");
-
-  man->CreateNtuple("windowhits", "Particles exiting window");
-  man->CreateNtupleIColumn("eventID");   // <-- NEW
-  man->CreateNtupleIColumn("pdg");
-  man->CreateNtupleDColumn("x");
-  man->CreateNtupleDColumn("y");
-  man->CreateNtupleDColumn("z");
-  man->CreateNtupleDColumn("px");
-  man->CreateNtupleDColumn("py");
-  man->CreateNtupleDColumn("pz");
-  man->CreateNtupleDColumn("ekin");
-  man->FinishNtuple();
-  
-  man->CreateNtuple("hits", "Particles crossing virtual detector");
-  man->CreateNtupleIColumn("eventID");   // <-- NEW
-  man->CreateNtupleIColumn("pdg");
-  man->CreateNtupleDColumn("x");
-  man->CreateNtupleDColumn("y");
-  man->CreateNtupleDColumn("z");
-  man->CreateNtupleDColumn("px");
-  man->CreateNtupleDColumn("py");
-  man->CreateNtupleDColumn("pz");
-  man->CreateNtupleDColumn("ekin");
-  man->FinishNtuple();
+  // The ntuples are booked by HitOutput at the start of the first run, so
+  // that the /waterRadiator/output/ commands can choose their columns and
+  // the file format
+  fHitOutput = new HitOutput;
+  fBenchmark = new Benchmark;
+  fStepProfiler = new StepProfiler;
+  fPhotonFate = new PhotonFate;
+  fProgress = new Progress;
+}
 
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+RunAction::~RunAction()
+{
+  delete fHitOutput;
+  delete fBenchmark;
+  delete fStepProfiler;
+  delete fPhotonFate;
+  delete fProgress;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void RunAction::BeginOfRunAction(const G4Run*)
+void RunAction::BeginOfRunAction(const G4Run* run)
 {
   // inform the runManager to save random number seed
   G4RunManager::GetRunManager()->SetRandomNumberStore(false);
@@ -109,12 +103,19 @@ void RunAction::BeginOfRunAction(const G4Run*)
   // reset accumulables to their initial values
   G4AccumulableManager* accumulableManager = G4AccumulableManager::Instance();
   accumulableManager->Reset();
+  fTimer.Start();
+  if (IsMaster()) fBenchmark->BeginOfRun();
+  fStepProfiler->BeginOfRun();
+  fProgress->BeginOfRun(run->GetRunID(), run->GetNumberOfEventToBeProcessed());
   // Open root file
-  auto man = G4AnalysisManager::Instance();
   G4cout << "About to open root file"<<std::endl;
 
-  man->OpenFile("output.root");
-
+  const auto detConstruction = static_cast<const DetectorConstruction*>(
+    G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  fHitOutput->SetFateColumns(fPhotonFate->HasEventColumns());
+  fHitOutput->Book(detConstruction);
+  fHitOutput->BeginOfRun(detConstruction, run->GetRunID());
+  fPhotonFate->BeginOfRun(detConstruction->GetDetectorVolume());
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -122,20 +123,23 @@ void RunAction::BeginOfRunAction(const G4Run*)
 void RunAction::EndOfRunAction(const G4Run* run)
 {
   // Close the root file
-  auto man = G4AnalysisManager::Instance();
-  
   G4cout << "About to close root file "<<std::endl;
 
-  man->Write();
-  man->CloseFile();
+  fHitOutput->EndOfRun();
+  fStepProfiler->EndOfRun();
+  fPhotonFate->EndOfRun();
+  fProgress->EndOfRun();
 
-  G4int nofEvents = run->GetNumberOfEvent();
-  if (nofEvents == 0) return;
+  fTimer.Stop();
 
-  // Merge accumulables
+  // Merge accumulables, also from a thread without events, as its output
+  // files count in the size on disk
   G4AccumulableManager* accumulableManager = G4AccumulableManager::Instance();
   accumulableManager->Merge();
 
+  G4int nofEvents = run->GetNumberOfEvent();
+  if (nofEvents == 0) return;
+
   // Compute dose = total energy deposit in a run and its variance
   //
   G4double edep = fEdep.GetValue();
@@ -183,6 +187,23 @@ void RunAction::EndOfRunAction(const G4Run* run)
   G4cout << " Absorbed dose per run in scoring volume = edep/mass = " << G4BestUnit(dose, "Dose")
          << "; rms = " << G4BestUnit(rmsDose, "Dose") << G4endl
          << "------------------------------------------------------------" << G4endl << G4endl;
+
+  // Optical photon navigation benchmark
+  G4long nPhotons = fNPhotons.GetValue();
+  G4long nPhotonSteps = fNPhotonSteps.GetValue();
+  G4double realTime = fTimer.GetRealElapsed();
+  G4cout << " Optical photons tracked = " << nPhotons;
+  if (nPhotons > 0) {
+    G4cout << "; steps per photon = " << G4double(nPhotonSteps) / nPhotons;
+  }
+  if (realTime > 0.) {
+    G4cout << "; photons/s = " << nPhotons / realTime << " (" << realTime << " s)";
+  }
+  G4cout << G4endl << G4endl;
+
+  if (IsMaster()) {
+    fBenchmark->EndOfRun(nofEvents, nPhotons, nPhotonSteps, realTime, *fStepProfiler);
+  }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -195,4 +216,12 @@ void RunAction::AddEdep(G4double edep)
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void RunAction::AddPhotons(G4long nPhotons, G4long nSteps)
+{
+  fNPhotons += nPhotons;
+  fNPhotonSteps += nSteps;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 }  // namespace B1
@@ -0,0 +1,313 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file StepProfiler.cc
+/// \brief Implementation of the B1::StepProfiler class
+
+#include "StepProfiler.hh"
+
+#include "G4AccumulableManager.hh"
+#include "G4GenericMessenger.hh"
+#include "G4LogicalVolume.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Threading.hh"
+#include "G4VProcess.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+namespace B1
+{
+
+namespace
+{
+struct Row
+{
+  G4String name;
+  G4long steps = 0;
+  G4double seconds = 0.;
+};
+
+// Sorts the rows by time and prints them with their share of the total
+void PrintRows(const G4String& title, std::vector<Row> rows)
+{
+  std::sort(rows.begin(), rows.end(),
+            [](const Row& a, const Row& b) { return a.seconds > b.seconds; });
+  G4long steps = 0;
+  G4double seconds = 0.;
+  for (const auto& row : rows) {
+    steps += row.steps;
+    seconds += row.seconds;
+  }
+  if (steps == 0) return;
+
+  G4cout << G4endl << " " << title << G4endl << std::setw(22) << "" << std::setw(14) << "steps"
+         << std::setw(8) << "%" << std::setw(12) << "time(s)" << std::setw(8) << "%"
+         << std::setw(12) << "ns/step" << G4endl;
+  for (const auto& row : rows) {
+    G4cout << std::setw(22) << row.name << std::setw(14) << row.steps << std::setw(8)
+           << std::fixed << std::setprecision(1) << 100. * row.steps / steps << std::setw(12)
+           << std::setprecision(3) << row.seconds << std::setw(8) << std::setprecision(1)
+           << (seconds > 0. ? 100. * row.seconds / seconds : 0.) << std::setw(12)
+           << std::setprecision(0) << (row.steps > 0 ? 1e9 * row.seconds / row.steps : 0.)
+           << std::defaultfloat << std::setprecision(6) << G4endl;
+  }
+}
+}  // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+StepProfiler::StepProfiler()
+{
+  G4AccumulableManager::Instance()->Register(&fProfile);
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+StepProfiler::~StepProfiler()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StepProfiler::BeginOfRun()
+{
+  // fProfile is reset by RunAction with the other accumulables
+  fCurrent = nullptr;
+  fLast = Clock::now();
+
+  fLimited.clear();
+  fLimitedProcess = nullptr;
+  for (auto timer : ProcessTimer::Timers()) timer->Reset();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StepProfiler::EndOfRun()
+{
+  if (!fEnabled && !IsTimingProcesses()) return;
+
+  // Keyed by process name, so the threads' tallies add up in the merge
+  if (IsTimingProcesses()) AddProcesses(fProfile.processes, CollectProcesses());
+
+  // The master ends its run after the workers have merged theirs
+  if (G4Threading::IsWorkerThread()) return;
+  if (fEnabled) Print();
+  if (IsTimingProcesses()) PrintProcesses();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+StepProfiler::ProcessTallies StepProfiler::CollectProcesses() const
+{
+  ProcessTallies processes;
+  for (const auto& [process, steps] : fLimited) {
+    processes[process ? process->GetProcessName() : G4String("(none)")].limited += steps;
+  }
+  for (auto timer : ProcessTimer::Timers()) {
+    if (timer->GetPostStepGPIL().calls == 0 && timer->GetAlongStepDoIt().calls == 0) continue;
+    auto& tally = processes[timer->GetProcessName()];
+    for (auto [total, counter] : {std::make_pair(&tally.postStepGPIL, &timer->GetPostStepGPIL()),
+                                  std::make_pair(&tally.alongStepDoIt, &timer->GetAlongStepDoIt()),
+                                  std::make_pair(&tally.postStepDoIt, &timer->GetPostStepDoIt())}) {
+      total->calls += counter->calls;
+      total->time += counter->time;
+    }
+  }
+  return processes;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StepProfiler::AddProcesses(ProcessTallies& to, const ProcessTallies& from)
+{
+  for (const auto& [name, tally] : from) {
+    auto& total = to[name];
+    total.limited += tally.limited;
+    total.postStepGPIL.calls += tally.postStepGPIL.calls;
+    total.postStepGPIL.time += tally.postStepGPIL.time;
+    total.alongStepDoIt.calls += tally.alongStepDoIt.calls;
+    total.alongStepDoIt.time += tally.alongStepDoIt.time;
+    total.postStepDoIt.calls += tally.postStepDoIt.calls;
+    total.postStepDoIt.time += tally.postStepDoIt.time;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StepProfiler::Profile::Merge(const G4VAccumulable& other)
+{
+  const auto& profile = static_cast<const Profile&>(other);
+  for (const auto& [key, tally] : profile.steps) {
+    auto& total = steps[key];
+    total.steps += tally.steps;
+    total.time += tally.time;
+  }
+  AddProcesses(processes, profile.processes);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StepProfiler::Profile::Reset()
+{
+  steps.clear();
+  processes.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#if G4VERSION_NUMBER >= 1120
+void StepProfiler::Profile::Print(G4PrintOptions) const
+{
+  G4cout << GetName() << ": " << steps.size() << " volume and particle tallies, "
+         << processes.size() << " processes" << G4endl;
+}
+#endif
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StepProfiler::Print() const
+{
+  std::map<const G4LogicalVolume*, Row> volumes, photonVolumes;
+  std::map<const G4ParticleDefinition*, Row> particles;
+  for (const auto& [key, tally] : fProfile.steps) {
+    G4double seconds = std::chrono::duration<G4double>(tally.time).count();
+    for (auto row : {&volumes[key.first], &particles[key.second]}) {
+      row->steps += tally.steps;
+      row->seconds += seconds;
+    }
+    if (key.second == G4OpticalPhoton::Definition()) {
+      auto& row = photonVolumes[key.first];
+      row.steps += tally.steps;
+      row.seconds += seconds;
+    }
+  }
+
+  auto volumeRows = [](std::map<const G4LogicalVolume*, Row>& rows) {
+    std::vector<Row> list;
+    for (auto& [volume, row] : rows) {
+      row.name = volume ? volume->GetName() : G4String("(none)");
+      list.push_back(row);
+    }
+    return list;
+  };
+  std::vector<Row> particleRows;
+  for (auto& [particle, row] : particles) {
+    row.name = particle->GetParticleName();
+    particleRows.push_back(row);
+  }
+
+  G4cout << G4endl << "--------------------Step profile--------------------------";
+  PrintRows("By volume", volumeRows(volumes));
+  PrintRows("By particle", particleRows);
+  PrintRows("Optical photons by volume", volumeRows(photonVolumes));
+  G4cout << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StepProfiler::PrintProcesses() const
+{
+  auto seconds = [](const ProcessTimer::Counter& counter) {
+    return std::chrono::duration<G4double>(counter.time).count();
+  };
+
+  G4long steps = 0;
+  for (const auto& [name, tally] : fProfile.processes) steps += tally.limited;
+
+  G4cout << G4endl << "--------------------Process profile-----------------------" << G4endl
+         << " Steps limited by" << G4endl;
+  for (const auto& [name, tally] : fProfile.processes) {
+    if (tally.limited == 0) continue;
+    G4cout << std::setw(22) << name << std::setw(14) << tally.limited << std::setw(8)
+           << std::fixed << std::setprecision(1) << 100. * tally.limited / steps
+           << std::defaultfloat << std::setprecision(6) << G4endl;
+  }
+
+  G4cout << G4endl << " Optical processes (calls, s)" << G4endl << std::setw(22) << ""
+         << std::setw(14) << "PostStepGPIL" << std::setw(10) << "" << std::setw(14)
+         << "AlongStepDoIt" << std::setw(10) << "" << std::setw(14) << "PostStepDoIt"
+         << std::setw(10) << "" << G4endl;
+  for (const auto& [name, tally] : fProfile.processes) {
+    if (tally.postStepGPIL.calls == 0 && tally.alongStepDoIt.calls == 0) continue;
+    G4cout << std::setw(22) << name << std::fixed << std::setprecision(3);
+    for (const auto* counter : {&tally.postStepGPIL, &tally.alongStepDoIt, &tally.postStepDoIt}) {
+      G4cout << std::setw(14) << counter->calls << std::setw(10) << seconds(*counter);
+    }
+    G4cout << std::defaultfloat << std::setprecision(6) << G4endl;
+  }
+  G4cout << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StepProfiler::WriteProcessesJSON(std::ostream& out) const
+{
+  auto counter = [&out](const char* name, const ProcessTimer::Counter& counter) {
+    out << ", \"" << name << "Calls\": " << counter.calls << ", \"" << name
+        << "Seconds\": " << std::chrono::duration<G4double>(counter.time).count();
+  };
+
+  out << "{";
+  G4bool first = true;
+  for (const auto& [name, tally] : fProfile.processes) {
+    out << (first ? "" : ", ") << "\"" << name << "\": {\"stepsLimited\": " << tally.limited;
+    counter("postStepGPIL", tally.postStepGPIL);
+    counter("alongStepDoIt", tally.alongStepDoIt);
+    counter("postStepDoIt", tally.postStepDoIt);
+    out << "}";
+    first = false;
+  }
+  out << "}";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StepProfiler::DefineCommands()
+{
+  // Define /waterRadiator/profile command directory using generic messenger class
+  fMessenger = new G4GenericMessenger(this, "/waterRadiator/profile/", "Step profiler");
+
+  auto& enableCmd = fMessenger->DeclareProperty("enable", fEnabled,
+    "Count the steps and time per volume and particle, printed at the end of each run.");
+  enableCmd.SetParameterName("enable", true);
+  enableCmd.SetDefaultValue("true");
+
+  // The wrappers are put around the processes when the physics is built
+  auto& processesCmd = fMessenger->DeclareProperty("processes", ProcessTimer::fEnabled,
+    "Time the optical processes and count the steps each process limits (before /run/initialize).");
+  processesCmd.SetParameterName("processes", true);
+  processesCmd.SetDefaultValue("true");
+  processesCmd.SetStates(G4State_PreInit);
+  processesCmd.SetToBeBroadcasted(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+}  // namespace B1
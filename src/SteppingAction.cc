@@ -30,9 +30,12 @@
 
 #include "DetectorConstruction.hh"
 #include "EventAction.hh"
+#include "PhotonFate.hh"
+#include "StepProfiler.hh"
 
 #include "G4Event.hh"
 #include "G4LogicalVolume.hh"
+#include "G4OpticalPhoton.hh"
 #include "G4RunManager.hh"
 #include "G4Step.hh"
 
@@ -41,7 +44,10 @@ namespace B1
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-SteppingAction::SteppingAction(EventAction* eventAction) : fEventAction(eventAction) {}
+SteppingAction::SteppingAction(EventAction* eventAction, StepProfiler* profiler,
+                               PhotonFate* fate)
+  : fEventAction(eventAction), fProfiler(profiler), fFate(fate)
+{}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -53,10 +59,23 @@ void SteppingAction::UserSteppingAction(const G4Step* step)
     fScoringVolume = detConstruction->GetScoringVolume();
   }
 
+  // count optical photons and their steps, for the navigation benchmarks
+  const G4Track* track = step->GetTrack();
+  if (track->GetDefinition() == G4OpticalPhoton::Definition()) {
+    if (track->GetCurrentStepNumber() == 1) fEventAction->AddPhoton();
+    fEventAction->AddPhotonStep();
+  }
+
   // get volume of the current step
   G4LogicalVolume* volume =
     step->GetPreStepPoint()->GetTouchableHandle()->GetVolume()->GetLogicalVolume();
 
+  if (fProfiler->IsEnabled()) fProfiler->Step(volume, track->GetDefinition());
+  if (fFate->IsEnabled()) fFate->Step(step);
+  if (fProfiler->IsTimingProcesses()) {
+    fProfiler->Limited(step->GetPostStepPoint()->GetProcessDefinedStep());
+  }
+
   // check if we are in scoring volume
   if (volume != fScoringVolume) return;
 
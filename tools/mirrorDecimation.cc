@@ -0,0 +1,200 @@
+/// \file mirrorDecimation.cc
+/// \brief Compare decimated versions of the tessellated mirror with the full mesh
+//
+// Usage: mirrorDecimation [file.stl] [maxDeviation/mm ...]
+//
+// For each deviation the mirror is decimated and a fixed set of Cherenkov
+// rays is traced from the radiator, reflected off both mirror copies and
+// intersected with the virtual detector planes. The spot RMS is computed per
+// plane the same way as RMSStudy.C (x and |y| RMS added in quadrature), and
+// compared with the full mesh at the full mesh's best focus.
+//
+// This is a purely geometric trace: the window is cut perpendicular to the
+// light so the rays leave the radiator unrefracted, and scattering and
+// absorption are ignored. It is meant for choosing a mesh, not for physics.
+
+#include "CADMesh.hh"
+#include "GeometryParameters.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+
+// All lengths are in mm, the unit of the mesh
+using namespace B1::Geometry;
+constexpr G4int NDET = nPlanes;
+
+const G4int nRays = 20000;
+
+struct Ray
+{
+  G4ThreeVector position;
+  G4ThreeVector direction;
+};
+
+struct Spot
+{
+  G4int n[NDET] = {0};
+  G4double x[NDET] = {0}, x2[NDET] = {0}, y[NDET] = {0}, y2[NDET] = {0};
+
+  G4double RMS(G4int i) const
+  {
+    if (n[i] == 0) return 0.;
+    G4double xMean = x[i] / n[i], yMean = y[i] / n[i];
+    G4double xRMS2 = x2[i] / n[i] - xMean * xMean;
+    G4double yRMS2 = y2[i] / n[i] - yMean * yMean;
+    return std::sqrt(std::max(0., xRMS2) + std::max(0., yRMS2));
+  }
+
+  G4int BestPlane() const
+  {
+    G4int best = -1;
+    for (G4int i = 0; i < NDET; i++) {
+      if (n[i] > 0 && (best < 0 || RMS(i) < RMS(best))) best = i;
+    }
+    return best;
+  }
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<Ray> MakeRays()
+{
+  std::mt19937_64 engine(12345);
+  std::normal_distribution<G4double> beam(0., beamSigma);
+  std::uniform_real_distribution<G4double> uniform(0., 1.);
+
+  std::vector<Ray> rays(nRays);
+  for (auto& ray : rays) {
+    G4double phi = 2. * M_PI * uniform(engine);
+    ray.position.set(beam(engine), beam(engine), radiatorLength * uniform(engine));
+    ray.direction.set(std::sin(cherenkovAngle) * std::cos(phi),
+                      std::sin(cherenkovAngle) * std::sin(phi),
+                      std::cos(cherenkovAngle));
+  }
+  return rays;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// Nearest hit of the ray on the triangles (Moller-Trumbore). Returns the
+// distance, or a negative number if there is no hit, and the facet normal.
+G4double Intersect(const Ray& ray, const CADMesh::Triangles& triangles, G4ThreeVector& normal)
+{
+  G4double nearest = -1.;
+  for (auto triangle : triangles) {
+    G4ThreeVector a = triangle->GetVertex(0);
+    G4ThreeVector e1 = triangle->GetVertex(1) - a;
+    G4ThreeVector e2 = triangle->GetVertex(2) - a;
+
+    G4ThreeVector p = ray.direction.cross(e2);
+    G4double det = e1.dot(p);
+    if (std::abs(det) < 1e-12) continue;
+
+    G4ThreeVector s = ray.position - a;
+    G4double u = s.dot(p) / det;
+    if (u < 0. || u > 1.) continue;
+
+    G4ThreeVector q = s.cross(e1);
+    G4double v = ray.direction.dot(q) / det;
+    if (v < 0. || u + v > 1.) continue;
+
+    G4double t = e2.dot(q) / det;
+    if (t > 1e-9 && (nearest < 0. || t < nearest)) {
+      nearest = t;
+      normal = e1.cross(e2).unit();
+    }
+  }
+  return nearest;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Spot Trace(const std::vector<Ray>& rays, const CADMesh::Triangles& triangles)
+{
+  Spot spot;
+  for (const auto& ray : rays) {
+    // The mirror copies are rotated about z; bring the ray into the frame of
+    // each copy and keep the nearest hit.
+    G4double nearest = -1.;
+    G4ThreeVector hit, reflected;
+    for (G4int i = 0; i < nMirrors; i++) {
+      G4double angle = -i * 2. * M_PI / nMirrors;
+      Ray local{G4ThreeVector(ray.position).rotateZ(angle),
+                G4ThreeVector(ray.direction).rotateZ(angle)};
+      G4ThreeVector normal;
+      G4double t = Intersect(local, triangles, normal);
+      if (t > 0. && (nearest < 0. || t < nearest)) {
+        nearest = t;
+        hit = (local.position + t * local.direction).rotateZ(-angle);
+        reflected = (local.direction - 2. * local.direction.dot(normal) * normal).rotateZ(-angle);
+      }
+    }
+    if (nearest < 0. || reflected.z() == 0.) continue;
+
+    for (G4int i = 0; i < NDET; i++) {
+      G4double t = (planeZ0 + i * planeDeltaZ - hit.z()) / reflected.z();
+      if (t <= 0.) continue;
+      G4ThreeVector p = hit + t * reflected;
+      if (p.perp() < planeRMin || p.perp() > planeRMax) continue;
+      G4double absy = std::abs(p.y());
+      spot.n[i]++;
+      spot.x[i] += p.x();
+      spot.x2[i] += p.x() * p.x();
+      spot.y[i] += absy;
+      spot.y2[i] += absy * absy;
+    }
+  }
+  return spot;
+}
+
+}  // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int main(int argc, char** argv)
+{
+  G4String fileName = argc > 1 ? argv[1] : "Mirror.stl";
+
+  std::vector<G4double> deviations;
+  for (G4int i = 2; i < argc; i++) deviations.push_back(std::atof(argv[i]));
+  if (deviations.empty()) deviations = {0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.};
+
+  auto reader = CADMesh::File::BuiltIn();
+  if (!reader->Read(fileName)) return 1;
+  auto mesh = reader->GetMesh();
+
+  auto rays = MakeRays();
+
+  auto full = Trace(rays, mesh->GetTriangles());
+  G4int focus = full.BestPlane();
+  if (focus < 0) {
+    std::printf("No rays from the full mesh reach the detector planes\n");
+    return 1;
+  }
+  G4double fullRMS = full.RMS(focus);
+
+  std::printf("%s: %zu facets, best focus at z = %.0f mm, rRMS = %.3f mm (%d rays)\n\n",
+              fileName.c_str(), mesh->GetTriangles().size(), planeZ0 + focus * planeDeltaZ,
+              fullRMS, full.n[focus]);
+  std::printf("%14s %8s %10s %10s %12s %12s %10s\n", "maxDev(mm)", "facets", "fraction",
+              "bestZ(mm)", "bestRMS(mm)", "RMS@focus", "shift(mm)");
+
+  for (auto deviation : deviations) {
+    auto decimated = mesh->Decimate(deviation);
+    auto spot = Trace(rays, decimated->GetTriangles());
+    G4int best = spot.BestPlane();
+    G4double facets = decimated->GetTriangles().size();
+
+    std::printf("%14g %8.0f %10.3f %10.0f %12.3f %12.3f %10.3f\n", deviation, facets,
+                facets / mesh->GetTriangles().size(), best < 0 ? 0. : planeZ0 + best * planeDeltaZ,
+                best < 0 ? 0. : spot.RMS(best), spot.RMS(focus), spot.RMS(focus) - fullRMS);
+  }
+
+  return 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
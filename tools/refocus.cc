@@ -0,0 +1,260 @@
+/// \file refocus.cc
+/// \brief Find the focus by propagating the photons of one plane to any z
+//
+// Usage: refocus [-p plane] [-z zMin zMax step] [-d dofFactor] file.root ...
+//
+// The photons recorded on the reference plane (default 0) are moved along
+// their momentum, px/pz and py/pz, to each z of a fine scan, and the spot
+// RMS is computed per event the same way as RMSStudy.C (x and |y| RMS added
+// in quadrature) and averaged over the events. It prints the scan, the best
+// focus and the depth of field: the z range where the mean r RMS is within
+// dofFactor (default sqrt(2)) of the minimum. The scan defaults to the span
+// of the detector planes, or +-200 mm around the reference if there is one,
+// in 0.5 mm steps.
+//
+// The propagation is a straight line in the medium of the planes, so the
+// hits need the x, y, z, px, py, pz and plane columns. |y| is propagated
+// with the sign y has on the reference plane; the two spots stay on their
+// own side of y = 0 over any sensible scan.
+//
+// Within an event the RMS at z is a quadratic in z - zRef, so each event
+// is reduced once to its moments and the scan only evaluates quadratics.
+// Both loops run over structure-of-arrays buffers so they vectorize.
+
+#include <TFile.h>
+#include <TTreeReader.h>
+#include <TTreeReaderValue.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// The photons of one file on the reference plane, moved to zRef, with the
+// start of each event's photons
+struct Photons
+{
+  std::vector<double> x, y, tx, ty;  // y is |y|, ty its slope
+  std::vector<size_t> eventStart;
+};
+
+// Per event, the RMS^2 of x and of |y| as a + b dz + c dz^2
+struct Quadratics
+{
+  std::vector<double> ax, bx, cx, ay, by, cy;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Usage()
+{
+  std::printf("Usage: refocus [-p plane] [-z zMin zMax step] [-d dofFactor] file.root ...\n");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// Adds the quadratic of the n photons at u with slopes t
+void AddQuadratic(const double* u, const double* t, size_t n, std::vector<double>& a,
+                  std::vector<double>& b, std::vector<double>& c)
+{
+  double su = 0., suu = 0., st = 0., stt = 0., sut = 0.;
+#pragma omp simd reduction(+ : su, suu, st, stt, sut)
+  for (size_t i = 0; i < n; i++) {
+    su += u[i];
+    suu += u[i] * u[i];
+    st += t[i];
+    stt += t[i] * t[i];
+    sut += u[i] * t[i];
+  }
+  double uMean = su / n, tMean = st / n;
+  a.push_back(suu / n - uMean * uMean);
+  b.push_back(2. * (sut / n - uMean * tMean));
+  c.push_back(stt / n - tMean * tMean);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AddEvents(const Photons& photons, Quadratics& q)
+{
+  for (size_t e = 0; e < photons.eventStart.size(); e++) {
+    size_t first = photons.eventStart[e];
+    size_t last = e + 1 < photons.eventStart.size() ? photons.eventStart[e + 1] : photons.x.size();
+    if (last == first) continue;
+    AddQuadratic(&photons.x[first], &photons.tx[first], last - first, q.ax, q.bx, q.cx);
+    AddQuadratic(&photons.y[first], &photons.ty[first], last - first, q.ay, q.by, q.cy);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// Mean over the events of the x, y and r RMS at dz from the reference
+void MeanRMS(const Quadratics& q, double dz, double& xRMS, double& yRMS, double& rRMS)
+{
+  size_t n = q.ax.size();
+  double sx = 0., sy = 0., sr = 0.;
+#pragma omp simd reduction(+ : sx, sy, sr)
+  for (size_t i = 0; i < n; i++) {
+    double x2 = std::max(0., q.ax[i] + dz * (q.bx[i] + dz * q.cx[i]));
+    double y2 = std::max(0., q.ay[i] + dz * (q.by[i] + dz * q.cy[i]));
+    sx += std::sqrt(x2);
+    sy += std::sqrt(y2);
+    sr += std::sqrt(x2 + y2);
+  }
+  xRMS = sx / n;
+  yRMS = sy / n;
+  rRMS = sr / n;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<double> ReadPlanes(TFile& file)
+{
+  std::vector<double> zPlane;
+  TTreeReader reader("planes", &file);
+  if (reader.IsInvalid()) return zPlane;
+  TTreeReaderValue<int> plane(reader, "plane");
+  TTreeReaderValue<double> z(reader, "z");
+  while (reader.Next()) {
+    if (*plane >= (int)zPlane.size()) zPlane.resize(*plane + 1);
+    zPlane[*plane] = *z;
+  }
+  return zPlane;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// Reads the photons of the reference plane of one file, moved to zRef
+bool ReadPhotons(TFile& file, int refPlane, double zRef, Photons& photons)
+{
+  TTreeReader events("events", &file);
+  TTreeReader hits("hits", &file);
+  if (events.IsInvalid() || hits.IsInvalid()) return false;
+  TTreeReaderValue<int> hitFirst(events, "hitFirst");
+  TTreeReaderValue<int> hitCount(events, "hitCount");
+  TTreeReaderValue<int> plane(hits, "plane");
+  TTreeReaderValue<double> x(hits, "x"), y(hits, "y"), z(hits, "z");
+  TTreeReaderValue<double> px(hits, "px"), py(hits, "py"), pz(hits, "pz");
+
+  while (events.Next()) {
+    if (*hitCount == 0) continue;
+    photons.eventStart.push_back(photons.x.size());
+    for (long entry = *hitFirst; entry < *hitFirst + *hitCount; entry++) {
+      if (hits.SetEntry(entry) != TTreeReader::kEntryValid) return false;
+      if (*plane != refPlane || *pz == 0.) continue;
+      double tx = *px / *pz, ty = *py / *pz;
+      double dz = zRef - *z;
+      double sign = *y < 0. ? -1. : 1.;
+      photons.x.push_back(*x + tx * dz);
+      photons.y.push_back(sign * (*y + ty * dz));
+      photons.tx.push_back(tx);
+      photons.ty.push_back(sign * ty);
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int main(int argc, char** argv)
+{
+  int refPlane = 0;
+  double zMin = 0., zMax = 0., step = 0.5;
+  bool zGiven = false;
+  double dofFactor = std::sqrt(2.);
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-p" && i + 1 < argc) {
+      refPlane = std::atoi(argv[++i]);
+    }
+    else if (arg == "-z" && i + 3 < argc) {
+      zMin = std::atof(argv[++i]);
+      zMax = std::atof(argv[++i]);
+      step = std::atof(argv[++i]);
+      zGiven = true;
+    }
+    else if (arg == "-d" && i + 1 < argc) {
+      dofFactor = std::atof(argv[++i]);
+    }
+    else if (arg[0] == '-') {
+      Usage();
+      return 1;
+    }
+    else {
+      files.push_back(arg);
+    }
+  }
+  // No default: output.root is the master's file in MT, which has no hits
+  if (files.empty()) {
+    std::printf("No input files\n");
+    Usage();
+    return 1;
+  }
+  if (step <= 0.) step = 0.5;
+
+  std::vector<double> zPlane;
+  Quadratics q;
+  for (const auto& fileName : files) {
+    std::unique_ptr<TFile> file(TFile::Open(fileName.c_str()));
+    if (!file || file->IsZombie()) continue;
+    auto layout = ReadPlanes(*file);
+    if (layout.empty()) continue;  // e.g. the master's file of an MT run
+    if (zPlane.empty()) zPlane = layout;
+    if (refPlane < 0 || refPlane >= (int)zPlane.size()) {
+      std::printf("There is no plane %d; the files have %zu\n", refPlane, zPlane.size());
+      return 1;
+    }
+
+    Photons photons;
+    if (!ReadPhotons(*file, refPlane, zPlane[refPlane], photons)) {
+      std::printf("%s has no event index or lacks the x, y, z, px, py, pz or plane columns\n",
+                  fileName.c_str());
+      return 1;
+    }
+    AddEvents(photons, q);
+  }
+  if (q.ax.empty()) {
+    std::printf("No photons on plane %d\n", refPlane);
+    return 1;
+  }
+
+  double zRef = zPlane[refPlane];
+  if (!zGiven) {
+    zMin = zPlane.size() > 1 ? zPlane.front() : zRef - 200.;
+    zMax = zPlane.size() > 1 ? zPlane.back() : zRef + 200.;
+  }
+
+  std::printf("Reference plane %d at z = %.1f mm, %zu events\n\n", refPlane, zRef, q.ax.size());
+  std::printf("%10s %10s %10s %10s\n", "z(mm)", "xRMS(mm)", "yRMS(mm)", "rRMS(mm)");
+
+  std::vector<double> zScan, rScan;
+  for (double z = zMin; z <= zMax + 0.5 * step; z += step) {
+    double xRMS, yRMS, rRMS;
+    MeanRMS(q, z - zRef, xRMS, yRMS, rRMS);
+    zScan.push_back(z);
+    rScan.push_back(rRMS);
+    std::printf("%10.2f %10.3f %10.3f %10.3f\n", z, xRMS, yRMS, rRMS);
+  }
+
+  size_t best = std::min_element(rScan.begin(), rScan.end()) - rScan.begin();
+  size_t lo = best, hi = best;
+  while (lo > 0 && rScan[lo - 1] <= dofFactor * rScan[best]) lo--;
+  while (hi + 1 < rScan.size() && rScan[hi + 1] <= dofFactor * rScan[best]) hi++;
+
+  std::printf("\nBest focus at z = %.2f mm, rRMS = %.3f mm\n", zScan[best], rScan[best]);
+  std::printf("Depth of field (rRMS within %.3f of the minimum): %.2f to %.2f mm = %.2f mm%s\n",
+              dofFactor, zScan[lo], zScan[hi], zScan[hi] - zScan[lo],
+              (lo == 0 || hi + 1 == rScan.size()) ? " (reaches the end of the scan)" : "");
+  return 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,538 @@
+/// \file waterAnalysis.cc
+/// \brief Compiled batch version of the Analyze.C and RMSStudy.C analyses
+//
+// Usage: waterAnalysis [-o histograms.root] [-s summary.json] [-l fileList]
+//                      [-i state.root] [file.root ...]
+//
+// Reads the simulation output files given on the command line, and those
+// listed one per line in fileList (at least one in all), and writes the histograms of Analyze.C
+// (nphotons) and RMSStudy.C (nphotonsZ, xrms, yrms, rrms) to a ROOT file,
+// and a JSON summary with the totals and the mean spot RMS on each plane.
+//
+// Events are read through the events index, so the window photon count
+// needs no hits at all and the detector hits are read one event range at
+// a time. Only the plane, x and y branches of the hits are read.
+//
+// With -i the analysis is incremental: the state file keeps, for every
+// input it has seen, the file's size and modification time and its own
+// histograms and totals. Inputs that are unchanged are taken from the
+// state, new or changed ones are read and their results stored, and the
+// output is the sum over the inputs given. A daily summary over a growing
+// list of files then only reads the new ones.
+
+#include <TDirectory.h>
+#include <TFile.h>
+#include <TH1F.h>
+#include <TH2F.h>
+#include <TNamed.h>
+#include <TTree.h>
+#include <TTreeReader.h>
+#include <TTreeReaderValue.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+// Totals per plane over all events, for the summary
+struct PlaneSummary
+{
+  double z = 0.;
+  long photons = 0;
+  long events = 0;  // events with photons on the plane
+  double xRMS = 0., yRMS = 0., rRMS = 0.;  // sums over those events
+};
+
+struct Histograms
+{
+  std::unique_ptr<TH1F> nphotons;
+  std::unique_ptr<TH2F> nphotonsZ, xrms, yrms, rrms;
+
+  std::vector<TH1*> All() const
+  {
+    return {nphotons.get(), nphotonsZ.get(), xrms.get(), yrms.get(), rrms.get()};
+  }
+};
+
+// What one or more input files add up to
+struct Result
+{
+  std::vector<double> zPlane;
+  Histograms h;
+  std::vector<PlaneSummary> planes;
+  long nEvents = 0;
+  long nWindowPhotons = 0;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Usage()
+{
+  std::printf("Usage: waterAnalysis [-o histograms.root] [-s summary.json] [-l fileList]"
+              " [-i state.root] [file.root ...]\n");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// The text as a quoted JSON string
+std::string JSONString(const std::string& text)
+{
+  std::string quoted = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20) {
+      char code[8];
+      std::snprintf(code, sizeof(code), "\\u%04x", c);
+      quoted += code;
+    }
+    else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// The z of each plane from the file's layout, indexed by plane
+std::vector<double> ReadPlanes(TFile& file)
+{
+  std::vector<double> zPlane;
+  TTreeReader reader("planes", &file);
+  if (reader.IsInvalid()) return zPlane;
+  TTreeReaderValue<int> plane(reader, "plane");
+  TTreeReaderValue<double> z(reader, "z");
+  while (reader.Next()) {
+    if (*plane >= (int)zPlane.size()) zPlane.resize(*plane + 1);
+    zPlane[*plane] = *z;
+  }
+  return zPlane;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BookHistograms(Histograms& h, const std::vector<double>& zPlane)
+{
+  // Same binning as Analyze.C and RMSStudy.C
+  int NDET = zPlane.size();
+  std::vector<double> zEdges(NDET + 1);
+  for (int i = 1; i < NDET; i++) zEdges[i] = (zPlane[i - 1] + zPlane[i]) / 2.;
+  zEdges[0] = NDET > 1 ? 2 * zPlane[0] - zEdges[1] : zPlane[0] - 1.;
+  zEdges[NDET] = NDET > 1 ? 2 * zPlane[NDET - 1] - zEdges[NDET - 1] : zPlane[0] + 1.;
+
+  h.nphotons.reset(new TH1F("nphotons", "Number of Photons Through Window;N Photons;Frequency",
+                            100, 0., 5000.));
+  h.nphotonsZ.reset(new TH2F("nphotonsZ", "Number of Photons in Cuts vs. Z", NDET, zEdges.data(),
+                             400, 0., 4000.));
+  h.xrms.reset(new TH2F("xrms", "X RMS vs. Z", NDET, zEdges.data(), 100, 0., 100.));
+  h.yrms.reset(new TH2F("yrms", "Y RMS vs. Z", NDET, zEdges.data(), 100, 0., 100.));
+  h.rrms.reset(new TH2F("rrms", "R RMS vs. Z", NDET, zEdges.data(), 100, 0., 200.));
+  for (auto hist : h.All()) hist->SetDirectory(nullptr);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// Reads the events of one file. Returns false if the file can't be used.
+bool ProcessFile(const std::string& fileName, Result& r)
+{
+  std::unique_ptr<TFile> file(TFile::Open(fileName.c_str()));
+  if (!file || file->IsZombie()) {
+    std::printf("Can't open %s\n", fileName.c_str());
+    return false;
+  }
+
+  r.zPlane = ReadPlanes(*file);
+  if (r.zPlane.empty()) {
+    // Also the master's file of an MT run, which holds no hits
+    std::printf("No plane layout in %s; skipped\n", fileName.c_str());
+    return false;
+  }
+  const auto& zPlane = r.zPlane;
+  auto& h = r.h;
+  auto& planes = r.planes;
+  BookHistograms(h, zPlane);
+  planes.resize(zPlane.size());
+  for (size_t i = 0; i < zPlane.size(); i++) planes[i].z = zPlane[i];
+  int NDET = zPlane.size();
+
+  TTreeReader events("events", file.get());
+  if (events.IsInvalid()) {
+    std::printf("No events ntuple in %s. It was made before the event index was saved.\n",
+                fileName.c_str());
+    return false;
+  }
+  TTreeReaderValue<int> windowCount(events, "windowCount");
+  TTreeReaderValue<int> hitFirst(events, "hitFirst");
+  TTreeReaderValue<int> hitCount(events, "hitCount");
+
+  TTreeReader hits("hits", file.get());
+  TTreeReaderValue<int> plane(hits, "plane");
+  TTreeReaderValue<double> x(hits, "x");
+  TTreeReaderValue<double> y(hits, "y");
+
+  std::vector<int> nphot(NDET);
+  std::vector<double> xmean(NDET), x2mean(NDET), ymean(NDET), y2mean(NDET);
+
+  while (events.Next()) {
+    r.nEvents++;
+    if (*windowCount > 0) {
+      h.nphotons->Fill(*windowCount);
+      r.nWindowPhotons += *windowCount;
+    }
+    if (*hitCount == 0) continue;
+
+    std::fill(nphot.begin(), nphot.end(), 0);
+    for (auto v : {&xmean, &x2mean, &ymean, &y2mean}) std::fill(v->begin(), v->end(), 0.);
+
+    for (long entry = *hitFirst; entry < *hitFirst + *hitCount; entry++) {
+      if (hits.SetEntry(entry) != TTreeReader::kEntryValid) break;
+      int iz = *plane;
+      if (iz < 0 || iz > NDET - 1) continue;
+      double absy = std::abs(*y);
+      nphot[iz] += 1;
+      xmean[iz] += *x;
+      x2mean[iz] += *x * *x;
+      ymean[iz] += absy;
+      y2mean[iz] += absy * absy;
+    }
+
+    for (int i = 0; i < NDET; i++) {
+      h.nphotonsZ->Fill(zPlane[i], nphot[i]);
+      // RMSStudy.C also fills the RMS of empty planes, as NaN; skip them
+      if (nphot[i] == 0) continue;
+      double xMean = xmean[i] / nphot[i], yMean = ymean[i] / nphot[i];
+      double xRMS = std::sqrt(std::max(0., x2mean[i] / nphot[i] - xMean * xMean));
+      double yRMS = std::sqrt(std::max(0., y2mean[i] / nphot[i] - yMean * yMean));
+      double rRMS = std::sqrt(xRMS * xRMS + yRMS * yRMS);
+      h.xrms->Fill(zPlane[i], xRMS);
+      h.yrms->Fill(zPlane[i], yRMS);
+      h.rrms->Fill(zPlane[i], rRMS);
+
+      planes[i].photons += nphot[i];
+      planes[i].events++;
+      planes[i].xRMS += xRMS;
+      planes[i].yRMS += yRMS;
+      planes[i].rRMS += rRMS;
+    }
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// Adds part to total. Returns false if their plane layouts differ.
+bool Add(Result& total, const Result& part)
+{
+  if (total.zPlane.empty()) {
+    total.zPlane = part.zPlane;
+    BookHistograms(total.h, total.zPlane);
+    total.planes.resize(part.planes.size());
+    for (size_t i = 0; i < total.planes.size(); i++) total.planes[i].z = part.planes[i].z;
+  }
+  else if (total.zPlane != part.zPlane) {
+    return false;
+  }
+
+  auto all = total.h.All(), partAll = part.h.All();
+  for (size_t i = 0; i < all.size(); i++) all[i]->Add(partAll[i]);
+  for (size_t i = 0; i < total.planes.size(); i++) {
+    auto& p = total.planes[i];
+    const auto& q = part.planes[i];
+    p.photons += q.photons;
+    p.events += q.events;
+    p.xRMS += q.xRMS;
+    p.yRMS += q.yRMS;
+    p.rRMS += q.rRMS;
+  }
+  total.nEvents += part.nEvents;
+  total.nWindowPhotons += part.nWindowPhotons;
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// Size and modification time, which tell whether an input changed
+std::string Stamp(const std::string& fileName)
+{
+  std::error_code error;
+  auto size = std::filesystem::file_size(fileName, error);
+  if (error) return "";
+  auto time = std::filesystem::last_write_time(fileName, error);
+  if (error) return "";
+  return std::to_string(size) + ":" + std::to_string(time.time_since_epoch().count());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SaveResult(TDirectory& dir, const std::string& fileName, const std::string& stamp,
+                const Result& r)
+{
+  dir.cd();
+  TNamed("path", fileName.c_str()).Write();
+  TNamed("stamp", stamp.c_str()).Write();
+  for (auto hist : r.h.All()) hist->Write();
+
+  // Per plane z, photons, events and the RMS sums, then the totals
+  std::vector<double> summary;
+  for (const auto& p : r.planes) {
+    summary.insert(summary.end(), {p.z, double(p.photons), double(p.events), p.xRMS, p.yRMS, p.rRMS});
+  }
+  summary.push_back(r.nEvents);
+  summary.push_back(r.nWindowPhotons);
+  dir.WriteObject(&summary, "summary");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool LoadResult(TDirectory& dir, Result& r)
+{
+  std::vector<double>* summary = nullptr;
+  dir.GetObject("summary", summary);
+  if (!summary || summary->size() < 2 || (summary->size() - 2) % 6 != 0) return false;
+
+  size_t nPlanes = (summary->size() - 2) / 6;
+  r.planes.resize(nPlanes);
+  r.zPlane.resize(nPlanes);
+  for (size_t i = 0; i < nPlanes; i++) {
+    const double* v = &(*summary)[6 * i];
+    r.zPlane[i] = r.planes[i].z = v[0];
+    r.planes[i].photons = v[1];
+    r.planes[i].events = v[2];
+    r.planes[i].xRMS = v[3];
+    r.planes[i].yRMS = v[4];
+    r.planes[i].rRMS = v[5];
+  }
+  r.nEvents = (*summary)[6 * nPlanes];
+  r.nWindowPhotons = (*summary)[6 * nPlanes + 1];
+  delete summary;
+
+  BookHistograms(r.h, r.zPlane);
+  for (auto hist : r.h.All()) {
+    TH1* stored = nullptr;
+    dir.GetObject(hist->GetName(), stored);
+    if (!stored) return false;
+    hist->Add(stored);
+    stored->SetDirectory(nullptr);
+    delete stored;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// The state file of an incremental analysis, with the directory of each
+// input it has seen
+struct State
+{
+  std::unique_ptr<TFile> file;
+  std::map<std::string, std::string> inputs;  // path -> directory
+  int next = 0;  // for the directory of the next new input
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool OpenState(const std::string& name, State& state)
+{
+  state.file.reset(TFile::Open(name.c_str(), "UPDATE"));
+  if (!state.file || state.file->IsZombie()) {
+    std::printf("Can't open the state file %s\n", name.c_str());
+    return false;
+  }
+
+  for (auto key : *state.file->GetListOfKeys()) {
+    std::string dirName = key->GetName();
+    if (dirName.compare(0, 5, "input") != 0) continue;
+    state.next = std::max(state.next, std::atoi(dirName.c_str() + 5) + 1);
+    auto dir = state.file->GetDirectory(dirName.c_str());
+    TNamed* path = nullptr;
+    if (dir) dir->GetObject("path", path);
+    if (path) state.inputs[path->GetTitle()] = dirName;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// Gets the result of a file from the state, or reads the file and stores
+// its result. Returns false if the file can't be used.
+bool IncrementalResult(State& state, const std::string& fileName, Result& r, bool& read)
+{
+  read = false;
+  std::string stamp = Stamp(fileName);
+
+  auto seen = state.inputs.find(fileName);
+  if (seen != state.inputs.end()) {
+    auto dir = state.file->GetDirectory(seen->second.c_str());
+    TNamed* stored = nullptr;
+    if (dir) dir->GetObject("stamp", stored);
+    if (stored && !stamp.empty() && stamp == stored->GetTitle() && LoadResult(*dir, r)) return true;
+  }
+
+  // LoadResult may have failed part way, so start from nothing
+  read = true;
+  r = Result();
+  if (!ProcessFile(fileName, r)) return false;
+
+  // New, or changed since it was stored: replace its result
+  std::string dirName;
+  if (seen == state.inputs.end()) {
+    dirName = "input" + std::to_string(state.next++);
+    state.inputs[fileName] = dirName;
+  }
+  else {
+    dirName = seen->second;
+    state.file->Delete((dirName + ";*").c_str());
+  }
+  auto dir = state.file->mkdir(dirName.c_str());
+  SaveResult(*dir, fileName, stamp, r);
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void WriteSummary(const std::string& name, const std::vector<std::string>& files,
+                  const std::vector<PlaneSummary>& planes, long nEvents, long nWindowPhotons)
+{
+  FILE* out = std::fopen(name.c_str(), "w");
+  if (!out) {
+    std::printf("Can't write %s\n", name.c_str());
+    return;
+  }
+
+  // The plane with the smallest mean spot is the focus
+  int focus = -1;
+  for (size_t i = 0; i < planes.size(); i++) {
+    if (planes[i].events == 0) continue;
+    if (focus < 0 || planes[i].rRMS / planes[i].events < planes[focus].rRMS / planes[focus].events) {
+      focus = i;
+    }
+  }
+
+  std::fprintf(out, "{\n  \"files\": [");
+  for (size_t i = 0; i < files.size(); i++) {
+    std::fprintf(out, "%s%s", i ? ", " : "", JSONString(files[i]).c_str());
+  }
+  std::fprintf(out, "],\n");
+  std::fprintf(out, "  \"events\": %ld,\n", nEvents);
+  std::fprintf(out, "  \"windowPhotons\": %ld,\n", nWindowPhotons);
+  std::fprintf(out, "  \"focusPlane\": %d,\n", focus);
+  std::fprintf(out, "  \"planes\": [\n");
+  for (size_t i = 0; i < planes.size(); i++) {
+    const auto& p = planes[i];
+    double n = p.events > 0 ? p.events : 1;
+    std::fprintf(out,
+                 "    {\"plane\": %zu, \"z\": %g, \"photons\": %ld, \"events\": %ld,"
+                 " \"meanXRMS\": %g, \"meanYRMS\": %g, \"meanRRMS\": %g}%s\n",
+                 i, p.z, p.photons, p.events, p.xRMS / n, p.yRMS / n, p.rRMS / n,
+                 i + 1 < planes.size() ? "," : "");
+  }
+  std::fprintf(out, "  ]\n}\n");
+  std::fclose(out);
+}
+
+}  // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int main(int argc, char** argv)
+{
+  std::string histogramName = "analysis.root";
+  std::string summaryName = "analysis.json";
+  std::string stateName;
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if ((arg == "-o" || arg == "-s" || arg == "-l" || arg == "-i") && i + 1 == argc) {
+      Usage();
+      return 1;
+    }
+    if (arg == "-o") {
+      histogramName = argv[++i];
+    }
+    else if (arg == "-s") {
+      summaryName = argv[++i];
+    }
+    else if (arg == "-i") {
+      stateName = argv[++i];
+    }
+    else if (arg == "-l") {
+      std::ifstream list(argv[++i]);
+      if (!list) {
+        std::printf("Can't read the file list %s\n", argv[i]);
+        return 1;
+      }
+      std::string line;
+      while (std::getline(list, line)) {
+        if (!line.empty() && line[0] != '#') files.push_back(line);
+      }
+    }
+    else if (arg == "-h" || arg == "--help") {
+      Usage();
+      return 0;
+    }
+    else {
+      files.push_back(arg);
+    }
+  }
+  // No default: output.root is the master's file in MT, which has no hits
+  if (files.empty()) {
+    std::printf("No input files\n");
+    Usage();
+    return 1;
+  }
+
+  State state;
+  if (!stateName.empty() && !OpenState(stateName, state)) return 1;
+
+  Result total;
+  std::vector<std::string> used;
+  int nRead = 0;
+  for (const auto& fileName : files) {
+    Result part;
+    bool read = true;
+    bool ok = state.file ? IncrementalResult(state, fileName, part, read)
+                         : ProcessFile(fileName, part);
+    if (!ok) continue;
+    if (!Add(total, part)) {
+      std::printf("%s has a different plane layout; skipped\n", fileName.c_str());
+      continue;
+    }
+    used.push_back(fileName);
+    if (read) nRead++;
+  }
+  if (state.file) state.file->Close();
+  if (used.empty()) {
+    std::printf("No usable input files\n");
+    return 1;
+  }
+
+  const auto& h = total.h;
+  TFile out(histogramName.c_str(), "RECREATE");
+  h.nphotons->Write();
+  h.nphotonsZ->Write();
+  h.xrms->Write();
+  h.yrms->Write();
+  h.rrms->Write();
+  out.Close();
+
+  WriteSummary(summaryName, used, total.planes, total.nEvents, total.nWindowPhotons);
+
+  std::printf("%zu files (%d read, %zu from the state), %ld events with hits, %ld window photons;"
+              " wrote %s and %s\n", used.size(), nRead, used.size() - nRead, total.nEvents,
+              total.nWindowPhotons, histogramName.c_str(), summaryName.c_str());
+  return 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
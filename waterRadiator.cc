@@ -28,6 +28,7 @@
 
 #include "ActionInitialization.hh"
 #include "DetectorConstruction.hh"
+#include "ProcessTimer.hh"
 #include "FTFP_BERT.hh"
 #include "G4OpticalPhysics.hh"
 #include "G4Cerenkov.hh"
@@ -77,6 +78,8 @@ int main(int argc, char** argv)
 
 
   physicsList->RegisterPhysics(opticalPhysics);  
+  // Last, so it can wrap the optical processes (/waterRadiator/profile/processes)
+  physicsList->RegisterPhysics(new ProcessTimerPhysics());
   
   
   physicsList->SetVerboseLevel(1);